@@ -0,0 +1,48 @@
+#version 460
+
+// Decodes one target of the G-buffer for renderGBufVisualizerUI().
+
+in vec2 vUV;
+
+layout(location = 0) out vec4 fColor;
+
+layout(binding = 0) uniform sampler2D uGBufDepthTex;
+layout(binding = 1) uniform sampler2D uGBufUVTex;
+layout(binding = 2) uniform sampler2D uGBufNormalMap;
+layout(binding = 3) uniform sampler2D uGBufAlbedoMap;
+layout(binding = 4) uniform sampler2D uGBufIrradianceTex;
+
+uniform mat4 uInvViewProj;
+// Same order as GBufVisTargetNames in Main.cpp.
+uniform int uTarget;
+
+#include "g-buffer.glsl"
+
+void main() {
+  float depth = texture(uGBufDepthTex, vUV).r;
+  if (depth >= 1.0) {
+    fColor = vec4(0.0, 0.0, 0.0, 1.0);
+    return;
+  }
+
+  vec3 color;
+  switch (uTarget) {
+  case 0:
+    color = reconstructPosition(vUV, depth, uInvViewProj);
+    break;
+  case 1:
+    color = vec3(texture(uGBufUVTex, vUV).rg, 0.0);
+    break;
+  case 2:
+    color = decodeNormal(texture(uGBufNormalMap, vUV).rg);
+    break;
+  case 3:
+    color = texture(uGBufAlbedoMap, vUV).rgb;
+    break;
+  default:
+    color = texture(uGBufIrradianceTex, vUV).rgb;
+    break;
+  }
+
+  fColor = vec4(color, 1.0);
+}
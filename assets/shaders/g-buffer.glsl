@@ -0,0 +1,23 @@
+// Encoding of the compact G-buffer, included by the passes that read it.
+
+// Octahedral normals, stored in RG16_SNORM.
+// https://jcgt.org/published/0003/02/01/
+vec2 signNotZero(vec2 v) { return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0); }
+
+vec2 encodeNormal(vec3 n) {
+  n /= abs(n.x) + abs(n.y) + abs(n.z);
+  return n.z >= 0.0 ? n.xy : (1.0 - abs(n.yx)) * signNotZero(n.xy);
+}
+
+vec3 decodeNormal(vec2 e) {
+  vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  if (n.z < 0.0)
+    n.xy = (1.0 - abs(n.yx)) * signNotZero(n.xy);
+  return normalize(n);
+}
+
+// World position from the depth buffer, uv in [0, 1].
+vec3 reconstructPosition(vec2 uv, float depth, mat4 invViewProj) {
+  vec4 world = invViewProj * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+  return world.xyz / world.w;
+}
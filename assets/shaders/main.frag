@@ -4,32 +4,68 @@ in vec2 vUV;
 
 out vec4 fColor;
 
+// Linear depth from the light (r), filtered. Blurred with the variance shadow map, whose second
+// moment is in g, see shadow.frag.
 layout(binding = 0) uniform sampler2D uLightShadowMap;
 
-layout(binding = 1) uniform sampler2D uGBufPosTex;
+// Layout described in g-buffer.frag.
+layout(binding = 1) uniform sampler2D uGBufDepthTex;
 layout(binding = 2) uniform sampler2D uGBufUVTex;
 layout(binding = 3) uniform sampler2D uGBufNormalMap;
 layout(binding = 4) uniform sampler2D uGBufAlbedoMap;
 layout(binding = 5) uniform sampler2D uGBufIrradianceTex;
 
+// In screen space, or in the UV atlas with uTextureSpaceDiffusion.
 layout(binding = 6) uniform sampler2D uBlurredIrradianceTex;
 
+// Beckmann distribution and Fresnel reflectance, see SpecularLUT.
+layout(binding = 7) uniform sampler2D uSpecularLUT;
+
+// Only bound when the blur runs at a reduced resolution, see sss-downsample.frag.
+layout(binding = 8) uniform sampler2D uBlurDepthTex;
+layout(binding = 9) uniform sampler2D uBlurNormalMap;
+
+// Transmittance profile indexed by thickness, see TransmittanceLUT.
+layout(binding = 10) uniform sampler1D uTransmittanceLUT;
+
 struct Light {
   vec3 direction;
   vec3 color;
   float intensity;
   mat4 VPMatrix;
+  mat4 viewMatrix;
 };
 
 uniform Light uLight;
+uniform mat4 uInvViewProj;
+uniform vec3 uCameraPosition;
 
 uniform bool uEnableTransmittance;
 uniform bool uEnableBlur;
+uniform bool uEnableSpecular;
 
 uniform float uTransmittanceStrength;
 uniform float uSSSWeight;
 uniform float uSSSWidth;
 uniform float uSSSNormalBias;
+uniform int uBlurScale;
+uniform bool uTextureSpaceDiffusion;
+uniform float uTransmittanceMaxThickness;
+// Only with the variance shadow map.
+uniform bool uUseShadows;
+uniform float uVSMBleedReduction;
+
+#include "g-buffer.glsl"
+#include "variance-shadow.glsl"
+
+// The LUTs are tabulated at i / (Size - 1), t in [0, 1] is moved to the texel centres.
+float LUTCoord(float t, int size) {
+  return (clamp(t, 0.0, 1.0) * float(size - 1) + 0.5) / float(size);
+}
+
+vec2 LUTCoord(vec2 t, ivec2 size) {
+  return (clamp(t, 0.0, 1.0) * vec2(size - 1) + 0.5) / vec2(size);
+}
 
 // http://www.iryoku.com/translucency/
 vec3 SSSTransmittance(vec3 pos, vec3 normal, vec3 lightDir, vec2 UVOffset) {
@@ -38,35 +74,108 @@ vec3 SSSTransmittance(vec3 pos, vec3 normal, vec3 lightDir, vec2 UVOffset) {
   vec4 shrunkPos = vec4(pos - 0.001 * normal, 1.0);
   vec4 shadowPos = uLight.VPMatrix * shrunkPos;
 
+  // Both depths are linear, the bilinear fetch filters the thickness over 2x2 texels.
   float d1 = texture(uLightShadowMap, (shadowPos.xy / shadowPos.w) * 0.5 + 0.5 + UVOffset).r;
-  float d2 = shadowPos.z * 0.5 + 0.5;
+  float d2 = -(uLight.viewMatrix * shrunkPos).z;
   float d = scale * abs(d1 - d2);
 
-  float dd = -d * d;
-  vec3 profile =
-    vec3(0.233, 0.455, 0.649) * exp(dd / 0.0064) +
-    vec3(0.1,   0.336, 0.344) * exp(dd / 0.0484) +
-    vec3(0.118, 0.198, 0.0)   * exp(dd / 0.187)  +
-    vec3(0.113, 0.007, 0.007) * exp(dd / 0.567)  +
-    vec3(0.358, 0.004, 0.0)   * exp(dd / 1.99)   +
-    vec3(0.078, 0.0,   0.0)   * exp(dd / 7.41);
+  float t = LUTCoord(d / uTransmittanceMaxThickness, textureSize(uTransmittanceLUT, 0));
+  vec3 profile = texture(uTransmittanceLUT, t).rgb;
 
   float approxBackCosTheta = clamp(uSSSNormalBias + dot(-normal, lightDir), 0.0, 1.0);
   return profile * approxBackCosTheta;
 }
 
+// Kelemen/Szirmay-Kalos skin specular (GPU Gems 3, chapter 14), with the unnormalized half
+// vector standing in for the geometric term.
+float skinSpecular(vec3 N, vec3 L, vec3 V, float intensity) {
+  float NdotL = dot(N, L);
+  if (NdotL <= 0.0 || intensity <= 0.0)
+    return 0.0;
+
+  vec3 h = L + V;
+  vec3 H = normalize(h);
+  vec2 t = LUTCoord(vec2(dot(N, H), dot(V, H)), textureSize(uSpecularLUT, 0));
+  vec2 DF = texture(uSpecularLUT, t).rg;
+  float D = pow(2.0 * DF.r, 10.0);
+  return NdotL * intensity * max(D * DF.g / dot(h, h), 0.0);
+}
+
+// Joint bilateral upsample of the blurred irradiance: the 4 low resolution texels around the
+// fragment are weighted by their bilinear weight and by how close their depth and normal are to
+// the full resolution ones.
+vec3 upsampleBlurredIrradiance(vec3 normal) {
+  float depth = texelFetch(uGBufDepthTex, ivec2(gl_FragCoord.xy), 0).r;
+
+  ivec2 size = textureSize(uBlurredIrradianceTex, 0);
+  vec2 p = gl_FragCoord.xy / float(uBlurScale) - 0.5;
+  ivec2 base = ivec2(floor(p));
+  vec2 f = p - vec2(base);
+
+  vec3 sum = vec3(0.0);
+  float weightSum = 0.0;
+  vec3 closest = vec3(0.0);
+  float closestDist = 1.0;
+  for (int i = 0; i < 4; i++) {
+    ivec2 offset = ivec2(i & 1, i >> 1);
+    ivec2 q = clamp(base + offset, ivec2(0), size - 1);
+
+    vec3 blurred = texelFetch(uBlurredIrradianceTex, q, 0).rgb;
+    float dist = abs(texelFetch(uBlurDepthTex, q, 0).r - depth);
+    if (dist < closestDist) {
+      closestDist = dist;
+      closest = blurred;
+    }
+
+    vec2 b = mix(1.0 - f, f, vec2(offset));
+    // Same scale as the depth rejection of the blur.
+    float wz = exp(-dist / 0.0002);
+    float wn = pow(max(dot(decodeNormal(texelFetch(uBlurNormalMap, q, 0).rg), normal), 0.0), 8.0);
+    float w = b.x * b.y * wz * wn;
+
+    sum += w * blurred;
+    weightSum += w;
+  }
+
+  // No texel lies on the same surface, fall back to the closest one.
+  return weightSum > 1e-4 ? sum / weightSum : closest;
+}
+
+vec3 blurredIrradiance(vec3 normal) {
+  if (uTextureSpaceDiffusion)
+    return texture(uBlurredIrradianceTex, texture(uGBufUVTex, vUV).rg).rgb;
+
+#ifdef SSS_INTERIOR_TILE
+  // Covered and continuous around the tile, the bilateral weights would all be equal.
+  vec2 blurSize = float(uBlurScale) * vec2(textureSize(uBlurredIrradianceTex, 0));
+  return texture(uBlurredIrradianceTex, gl_FragCoord.xy / blurSize).rgb;
+#else
+  return uBlurScale > 1 ? upsampleBlurredIrradiance(normal)
+                        : texture(uBlurredIrradianceTex, vUV).rgb;
+#endif
+}
+
 void main() {
-  vec3 pos = texture(uGBufPosTex, vUV).rgb;
-  vec3 normal = texture(uGBufNormalMap, vUV).rgb;
-  vec3 albedo = texture(uGBufAlbedoMap, vUV).rgb;
+  float depth = texelFetch(uGBufDepthTex, ivec2(gl_FragCoord.xy), 0).r;
+  vec3 pos = reconstructPosition(vUV, depth, uInvViewProj);
+  vec3 normal = decodeNormal(texture(uGBufNormalMap, vUV).rg);
+  vec4 albedo = texture(uGBufAlbedoMap, vUV);
 
   vec3 irradiance = texture(uGBufIrradianceTex, vUV).rgb;
   if (uEnableBlur)
-    irradiance = mix(irradiance, texture(uBlurredIrradianceTex, vUV).rgb, uSSSWeight);
+    irradiance = mix(irradiance, blurredIrradiance(normal), uSSSWeight);
 
   vec3 transmittance = vec3(0.0);
   if (uEnableTransmittance)
-    transmittance += SSSTransmittance(pos, normal, -uLight.direction, vec2(0.0)) * albedo;
+    transmittance += SSSTransmittance(pos, normal, -uLight.direction, vec2(0.0)) * albedo.rgb;
+
+  float specular = 0.0;
+  if (uEnableSpecular)
+    specular = skinSpecular(normal, -uLight.direction, normalize(uCameraPosition - pos), albedo.a);
+  // The irradiance is shadowed by the G-buffer pass, the transmittance goes through the model.
+  if (uUseShadows && specular > 0.0)
+    specular *= shadowVisibility(pos);
 
-  fColor = vec4(irradiance + transmittance * (uLight.color * uLight.intensity), 1.0);
+  vec3 lightColor = uLight.color * uLight.intensity;
+  fColor = vec4(irradiance + (transmittance + specular) * lightColor, 1.0);
 }
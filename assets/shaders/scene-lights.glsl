@@ -0,0 +1,47 @@
+// Scene lights, included by the passes that shade them: light-culling.comp in screen space and
+// g-buffer.frag in the texture-space atlas.
+
+#define LIGHT_POINT 0
+#define LIGHT_SPOT 1
+#define LIGHT_DIRECTIONAL 2
+
+// Same layout as SceneLight in Main.cpp, in world space.
+struct SceneLight {
+  vec4 positionRange;
+  vec4 directionType; // Direction the light points to.
+  vec4 color; // Premultiplied by the intensity.
+  vec4 spotCosines; // x: outer, y: inner.
+};
+
+layout(std430, binding = 1) readonly buffer SceneLights {
+  SceneLight sceneLights[];
+};
+
+// Inverse square falloff, 1 at half the range, windowed to reach 0 at the range.
+float attenuation(float dist, float range) {
+  float x = dist / range;
+  float window = clamp(1.0 - x * x * x * x, 0.0, 1.0);
+  return window * window * (0.25 * range * range) / (dist * dist + 1e-4);
+}
+
+// Diffuse lighting of a light at a world-space position, before the albedo.
+vec3 sceneLightIrradiance(SceneLight light, vec3 pos, vec3 normal) {
+  int type = int(light.directionType.w);
+
+  vec3 L;
+  float atten = 1.0;
+  if (type == LIGHT_DIRECTIONAL) {
+    L = -light.directionType.xyz;
+  } else {
+    vec3 toLight = light.positionRange.xyz - pos;
+    float dist = length(toLight);
+    L = toLight / dist;
+    atten = attenuation(dist, light.positionRange.w);
+    if (type == LIGHT_SPOT) {
+      float cosAngle = dot(-L, light.directionType.xyz);
+      atten *= smoothstep(light.spotCosines.x, light.spotCosines.y, cosAngle);
+    }
+  }
+
+  return light.color.rgb * (max(dot(normal, L), 0.0) * atten);
+}
@@ -0,0 +1,24 @@
+#version 460
+
+// One direction of the separable gaussian filtering the moments of the variance shadow map.
+
+in vec2 vUV;
+
+layout(location = 0) out vec2 fMoments;
+
+layout(binding = 0) uniform sampler2D uMoments;
+
+uniform vec2 uStep; // One texel along the direction.
+uniform int uRadius;
+
+void main() {
+  float sigma = 0.5 * float(uRadius) + 0.5;
+  vec2 sum = vec2(0.0);
+  float weightSum = 0.0;
+  for (int i = -uRadius; i <= uRadius; i++) {
+    float w = exp(-float(i * i) / (2.0 * sigma * sigma));
+    sum += w * texture(uMoments, vUV + float(i) * uStep).rg;
+    weightSum += w;
+  }
+  fMoments = sum / weightSum;
+}
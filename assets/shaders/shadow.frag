@@ -1,3 +1,9 @@
 #version 460
 
-void main() {}
+in float vLinearDepth;
+
+// Linear, so that the thickness can be filtered, see SSSTransmittance() in main.frag.
+// The square is only used by the variance shadow map.
+layout(location = 0) out vec2 fMoments;
+
+void main() { fMoments = vec2(vLinearDepth, vLinearDepth * vLinearDepth); }
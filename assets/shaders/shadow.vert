@@ -3,12 +3,12 @@
 layout(location = 0) in vec3 aPos;
 
 uniform mat4 uLightMVP;
+uniform mat4 uLightMV;
 
-void main() {
-  vec4 pos = uLightMVP * vec4(aPos, 1.0);
+// Distance to the light along its view direction, in world units.
+out float vLinearDepth;
 
-  // Make sure the depth is linear.
-  // https://github.com/iryoku/separable-sss/blob/master/Demo/Shaders/ShadowMap.fx
-  pos.z *= pos.w;
-  gl_Position = pos;
+void main() {
+  vLinearDepth = -(uLightMV * vec4(aPos, 1.0)).z;
+  gl_Position = uLightMVP * vec4(aPos, 1.0);
 }
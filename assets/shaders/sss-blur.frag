@@ -7,11 +7,15 @@
 
 // #define SSSS_FOLLOW_SURFACE 1
 
+// Taps whose depth differs from the center by more than this fraction of it are on another
+// surface.
+#define DEPTH_THRESHOLD 0.1
+
 in vec2 TexCoords;
 layout(location = 0) out vec4 FragColor;
 
+// rgb: irradiance, a: linear view depth. One fetch per tap.
 layout(binding = 0) uniform sampler2D uColorMap;
-layout(binding = 1) uniform sampler2D uDepthMap;
 layout(binding = 2) uniform sampler2D uCustomMap;
 layout(binding = 3) uniform sampler2D uUVMap;
 
@@ -23,7 +27,19 @@ uniform int uNumSamples;
 uniform vec3 uFalloff;
 uniform vec3 uStrength;
 uniform float uPhotonPathLength; // mm
-
+// Viewport size over the size of the blurred target, see sss-downsample.frag.
+uniform float uResolutionScale;
+// Subset of the taps blurred this frame, see sss-temporal.frag. The taps are scaled by the
+// stride so that the subsets average to the full kernel.
+uniform int uTapStride;
+uniform int uTapOffset;
+
+#ifdef SSS_SEPARABLE_PASS
+// Direction of this pass, the horizontal and vertical passes are two separate draws.
+uniform vec2 uDirection;
+#endif
+
+#ifdef SSS_PER_FRAGMENT_KERNEL
 vec4 kernel[MAX_NUM_SAMPLES];
 
 // https://github.com/iryoku/separable-sss/blob/master/Demo/Code/SeparableSSS.cpp#L172
@@ -100,12 +116,19 @@ void calculateKernel(int nSamples, vec3 falloff, vec3 strength) {
     kernel[i].z *= strength.z;
   }
 }
+#else
+// Computed on the CPU by SeparableKernel (BurleyKernel with SSS_BURLEY) whenever its
+// parameters change.
+layout(std140, binding = 0) uniform KernelBlock {
+  vec4 kernel[MAX_NUM_SAMPLES];
+};
+#endif
 
 // http://www.iryoku.com/separable-sss/
 vec4 applyBlur(float fovy, float sssWidth, int nSamples, vec2 uv, vec4 colorM, vec2 dir, float fwRel) {
   // #############################################
-  // Fetch linear depth of current pixel:
-  float depthM = texture(uDepthMap, TexCoords).r;
+  // Linear depth of current pixel, kept in the alpha of the output:
+  float depthM = colorM.a;
 
   // ############################################# old
   // Calculate the sssWidth scale (1.0 for a unit plane sitting on the projection window):
@@ -126,7 +149,7 @@ vec4 applyBlur(float fovy, float sssWidth, int nSamples, vec2 uv, vec4 colorM, v
 
   // Accumulate the other samples:
   nSamples = min(nSamples, MAX_NUM_SAMPLES);
-  for (int i = 1; i < nSamples; i++) {
+  for (int i = 1 + uTapOffset; i < nSamples; i += uTapStride) {
     // Fetch color and depth for current sample:
     vec2 offset = TexCoords + kernel[i].a * finalStep;
     vec4 color = texture(uColorMap, offset);
@@ -139,38 +162,78 @@ vec4 applyBlur(float fovy, float sssWidth, int nSamples, vec2 uv, vec4 colorM, v
     // color.rgb = mix(color.rgb, colorM.rgb, s);
     // #endif
     // ############################################# new
-    float depth = texture(uDepthMap, offset).r;
-    if (abs(depthM - depth) > 0.0002)
+    if (abs(depthM - color.a) > DEPTH_THRESHOLD * depthM)
       color.rgb = colorM.rgb;
     // #############################################
 
     // Accumulate:
-    colorBlurred.rgb += kernel[i].rgb * color.rgb;
+    colorBlurred.rgb += float(uTapStride) * kernel[i].rgb * color.rgb;
+  }
+
+  return colorBlurred;
+}
+
+#ifdef SSS_BURLEY
+#define GOLDEN_ANGLE 2.39996323
+
+// Rotates the spiral, changed every frame by the temporal accumulation.
+uniform float uRotation;
+
+// Radial version of applyBlur() for the importance-sampled Burley kernel: kernel[i].a is the
+// radius of the tap, its direction follows a golden-angle spiral so that consecutive radii are
+// spread around the center.
+vec4 applyRadialBlur(float sssWidth, int nSamples, vec4 colorM, float fwRel) {
+  float depthM = colorM.a;
+  float finalStep = sssWidth * fwRel * (1.0 / 3.0);
+
+  vec4 colorBlurred = colorM;
+  colorBlurred.rgb *= kernel[0].rgb;
+
+  nSamples = min(nSamples, MAX_NUM_SAMPLES);
+  for (int i = 1 + uTapOffset; i < nSamples; i += uTapStride) {
+    float angle = float(i) * GOLDEN_ANGLE + uRotation;
+    vec2 offset = TexCoords + vec2(cos(angle), sin(angle)) * (kernel[i].a * finalStep);
+    vec4 color = texture(uColorMap, offset);
+    if (abs(depthM - color.a) > DEPTH_THRESHOLD * depthM)
+      color.rgb = colorM.rgb;
+
+    colorBlurred.rgb += float(uTapStride) * kernel[i].rgb * color.rgb;
   }
 
   return colorBlurred;
 }
+#endif
 
 void main() {
   vec2 uv = texture(uUVMap, TexCoords).rg;
   float scale = HEAD_CIRCUMFERENCE_MM / uPhotonPathLength;
 
   vec2 fwuv = clamp(fwidth(uv),0.001,1000.0);
-  float fwz = fwidth(texture(uDepthMap, TexCoords).r);
-  float fwRel = 1 / (scale * distance(vec3(0.0), vec3(fwuv, fwz))); // with depth
-  // float fwRel = 1 / (scale * sqrt(fwuv.x * fwuv.x + fwuv.y * fwuv.y)); // without depth
+  // The derivative of the window depth that used to be added to fwuv was orders of magnitude
+  // below the clamp, the linear depth is only used for the rejection.
+  float fwRel = 1 / (scale * length(fwuv));
+  // The derivatives grow with the pixel footprint, keep the same width in texture space.
+  fwRel *= uResolutionScale;
 
   int nSamples = uNumSamples; // int((texture(uCustomMap, uv).r / 1) * 1 + 20);
   vec3 strength = uStrength; // texture(uCustomMap, uv).ggg;
   float sssWidth = uSSSWidth; // texture(uCustomMap, uv).r * 100;
+#ifdef SSS_PER_FRAGMENT_KERNEL
   calculateKernel(nSamples, uFalloff, strength);
+#endif
 
   // Fetch color of current pixel:
   vec4 colorM = texture(uColorMap, TexCoords);
 
+#if defined(SSS_BURLEY)
+  FragColor = applyRadialBlur(sssWidth, nSamples, colorM, fwRel);
+#elif defined(SSS_SEPARABLE_PASS)
+  FragColor = applyBlur(uFovy, sssWidth, nSamples, uv, colorM, uDirection, fwRel);
+#else
   // Not exactly a two-pass blur, but the results are almost the same.
   colorM = applyBlur(uFovy, sssWidth, nSamples, uv, colorM, vec2(1.0, 0.0), fwRel);
   FragColor = applyBlur(uFovy, sssWidth, nSamples, uv, colorM, vec2(0.0, 1.0), fwRel); // normal blur
+#endif
 
   // DEBUG
   // FragColor = texture(uCustomMap, uv); // map texture directly on face
@@ -0,0 +1,58 @@
+#version 460
+
+// Reduces the blur inputs to 1/uScale of the viewport. Each output pixel keeps the closest
+// covered sample of its footprint (depth, UV, normal) and averages the irradiance of the samples
+// lying on the same surface, so that silhouettes do not bleed into the background.
+
+in vec2 vUV;
+
+layout(location = 0) out vec4 fIrradiance; // a: linear view depth, see g-buffer.frag
+layout(location = 1) out vec2 fUV;
+layout(location = 2) out vec2 fNormal; // Octahedral, copied as is.
+
+layout(binding = 0) uniform sampler2D uGBufIrradianceTex;
+layout(binding = 1) uniform sampler2D uGBufDepthTex;
+layout(binding = 2) uniform sampler2D uGBufUVTex;
+layout(binding = 3) uniform sampler2D uGBufNormalMap;
+
+uniform int uScale;
+
+void main() {
+  ivec2 size = textureSize(uGBufDepthTex, 0);
+  ivec2 origin = ivec2(gl_FragCoord.xy) * uScale;
+
+  float closestDepth = 1.0;
+  ivec2 closest = origin;
+  for (int y = 0; y < uScale; y++) {
+    for (int x = 0; x < uScale; x++) {
+      ivec2 p = min(origin + ivec2(x, y), size - 1);
+      float depth = texelFetch(uGBufDepthTex, p, 0).r;
+      if (depth < closestDepth) {
+        closestDepth = depth;
+        closest = p;
+      }
+    }
+  }
+
+  // Nothing covered, leave the stencil cleared.
+  if (closestDepth >= 1.0)
+    discard;
+
+  vec3 irradiance = vec3(0.0);
+  float n = 0.0;
+  for (int y = 0; y < uScale; y++) {
+    for (int x = 0; x < uScale; x++) {
+      ivec2 p = min(origin + ivec2(x, y), size - 1);
+      if (abs(texelFetch(uGBufDepthTex, p, 0).r - closestDepth) > 0.0002)
+        continue;
+
+      irradiance += texelFetch(uGBufIrradianceTex, p, 0).rgb;
+      n += 1.0;
+    }
+  }
+
+  fIrradiance = vec4(irradiance / n, texelFetch(uGBufIrradianceTex, closest, 0).a);
+  fUV = texelFetch(uGBufUVTex, closest, 0).rg;
+  fNormal = texelFetch(uGBufNormalMap, closest, 0).rg;
+  gl_FragDepth = closestDepth;
+}
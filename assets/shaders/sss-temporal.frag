@@ -0,0 +1,62 @@
+#version 460
+
+// Accumulates the blurred irradiance of the frames into a history reprojected with the camera
+// matrices. Each frame only blurs with a subset of the kernel taps (see uTapStride in
+// sss-blur.frag), the history converges to the full kernel while the camera is still. The history
+// is clamped to the range of the current neighbourhood, which bounds the ghosting of the changes
+// the reprojection does not see.
+
+in vec2 vUV;
+
+layout(location = 0) out vec4 fColor; // rgb: color, a: number of accumulated frames
+
+layout(binding = 0) uniform sampler2D uBlurredTex;
+layout(binding = 1) uniform sampler2D uHistoryTex;
+layout(binding = 2) uniform sampler2D uDepthMap;
+layout(binding = 3) uniform sampler2D uPrevDepthMap;
+
+uniform mat4 uInvViewProj;
+uniform mat4 uPrevViewProj;
+uniform bool uHistoryValid;
+uniform float uMaxFrames;
+
+// On the window depth.
+#define DISOCCLUSION_THRESHOLD 0.0002
+
+void main() {
+  vec3 current = texture(uBlurredTex, vUV).rgb;
+  float depth = texture(uDepthMap, vUV).r;
+  if (depth >= 1.0 || !uHistoryValid) {
+    fColor = vec4(current, 1.0);
+    return;
+  }
+
+  vec4 world = uInvViewProj * vec4(vec3(vUV, depth) * 2.0 - 1.0, 1.0);
+  vec4 prevClip = uPrevViewProj * (world / world.w);
+  vec3 prev = (prevClip.xyz / prevClip.w) * 0.5 + 0.5;
+
+  // Outside of the previous frame, or hidden by something else in it.
+  if (any(lessThan(prev.xy, vec2(0.0))) || any(greaterThan(prev.xy, vec2(1.0))) ||
+      abs(texture(uPrevDepthMap, prev.xy).r - prev.z) > DISOCCLUSION_THRESHOLD) {
+    fColor = vec4(current, 1.0);
+    return;
+  }
+
+  vec4 history = texture(uHistoryTex, prev.xy);
+
+  ivec2 size = textureSize(uBlurredTex, 0);
+  ivec2 p = ivec2(gl_FragCoord.xy);
+  vec3 minColor = current;
+  vec3 maxColor = current;
+  for (int y = -1; y <= 1; y++) {
+    for (int x = -1; x <= 1; x++) {
+      vec3 c = texelFetch(uBlurredTex, clamp(p + ivec2(x, y), ivec2(0), size - 1), 0).rgb;
+      minColor = min(minColor, c);
+      maxColor = max(maxColor, c);
+    }
+  }
+  history.rgb = clamp(history.rgb, minColor, maxColor);
+
+  float n = min(history.a + 1.0, uMaxFrames);
+  fColor = vec4(mix(history.rgb, current, 1.0 / n), n);
+}
@@ -0,0 +1,32 @@
+#version 460
+
+// Same outputs as g-buffer.vert, but the mesh is rasterized at its UVs so that g-buffer.frag
+// writes the irradiance into the texture atlas.
+
+layout(location = 0) in vec3 aPos;
+layout(location = 1) in vec3 aNormal;
+layout(location = 2) in vec2 aUV;
+layout(location = 3) in vec3 aTangent;
+layout(location = 4) in vec3 aBitangent;
+
+uniform mat4 uModelMatrix;
+uniform mat4 uNormalMatrix;
+
+out vec3 vNormal;
+out vec3 vFragPos;
+out vec2 vUV;
+out mat3 vTBN;
+
+void main() {
+  vFragPos = (uModelMatrix * vec4(aPos, 1.0)).xyz;
+
+  vUV = aUV;
+  vNormal = normalize(uNormalMatrix * vec4(aNormal, 0.0)).xyz;
+
+  vec3 T = normalize((uModelMatrix * vec4(aTangent, 0.0)).xyz);
+  vec3 N = normalize((uModelMatrix * vec4(aNormal, 0.0)).xyz);
+  vec3 B = normalize((uModelMatrix * vec4(aBitangent, 0.0)).xyz);
+  vTBN = mat3(T, B, N);
+
+  gl_Position = vec4(aUV * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,35 @@
+#version 460
+
+// Expands the tiles listed by sss-classify-tiles.comp into quads, one instance per tile.
+// Outputs the same varyings as quad.vert and sss-blur.vert so the full-screen fragment shaders
+// can be reused.
+
+// TILE_SIZE must match SSSTileSize in Main.cpp.
+#define TILE_SIZE 16
+
+layout(std430, binding = 0) readonly buffer TileLists {
+  uvec4 commands[2];
+  uint tiles[];
+};
+
+// 0 for edge tiles, the maximum number of tiles for interior tiles.
+uniform int uTileOffset;
+// In pixels, the tiles are classified at full resolution.
+uniform vec2 uViewportSize;
+
+out vec2 vUV;
+out vec2 TexCoords;
+
+const vec2 Corners[6] =
+  vec2[](vec2(0.0, 0.0), vec2(1.0, 0.0), vec2(1.0, 1.0), vec2(0.0, 0.0), vec2(1.0, 1.0),
+         vec2(0.0, 1.0));
+
+void main() {
+  uint tile = tiles[uTileOffset + gl_InstanceID];
+  vec2 corner = (vec2(tile & 0xFFFFu, tile >> 16) + Corners[gl_VertexID]) * TILE_SIZE;
+  vec2 uv = min(corner / uViewportSize, vec2(1.0));
+
+  vUV = uv;
+  TexCoords = uv;
+  gl_Position = vec4(uv * 2.0 - 1.0, 0.0, 1.0);
+}
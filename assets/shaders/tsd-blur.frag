@@ -0,0 +1,44 @@
+#version 460
+
+// One direction of a gaussian of the texture-space diffusion chain (d'Eon et al., "Efficient
+// Rendering of Human Skin"). Only the texels covered by the mesh are gathered, and the result is
+// normalized by their weights, so that the islands of the atlas do not bleed black at their
+// borders. Uncovered texels next to an island receive its blurred color, which hides the seams
+// when the atlas is filtered.
+
+in vec2 vUV;
+
+layout(location = 0) out vec4 fBlurred;
+// Blended additively into the sum of the chain.
+layout(location = 1) out vec4 fWeighted;
+
+layout(binding = 0) uniform sampler2D uColorMap;
+// Depth of the atlas rasterization, 1.0 where the mesh is not mapped.
+layout(binding = 1) uniform sampler2D uCoverageMap;
+
+uniform vec2 uDirection;
+uniform float uSigma; // texels
+uniform vec3 uWeight;
+
+void main() {
+  ivec2 size = textureSize(uColorMap, 0);
+  ivec2 p = ivec2(gl_FragCoord.xy);
+  ivec2 dir = ivec2(uDirection);
+  int radius = max(int(ceil(3.0 * uSigma)), 1);
+
+  vec3 sum = vec3(0.0);
+  float weightSum = 0.0;
+  for (int i = -radius; i <= radius; i++) {
+    ivec2 q = clamp(p + i * dir, ivec2(0), size - 1);
+    if (texelFetch(uCoverageMap, q, 0).r >= 1.0)
+      continue;
+
+    float w = exp(-float(i * i) / (2.0 * uSigma * uSigma));
+    sum += w * texelFetch(uColorMap, q, 0).rgb;
+    weightSum += w;
+  }
+
+  vec3 blurred = weightSum > 0.0 ? sum / weightSum : vec3(0.0);
+  fBlurred = vec4(blurred, 1.0);
+  fWeighted = vec4(uWeight * blurred, 1.0);
+}
@@ -0,0 +1,17 @@
+// Variance shadow map lookup, included by the passes lit by the key light. Uses the uLight,
+// uLightShadowMap and uVSMBleedReduction of the including pass.
+
+// Chebyshev upper bound of the fraction of the filtered depths behind the fragment.
+float shadowVisibility(vec3 pos) {
+  vec4 shadowPos = uLight.VPMatrix * vec4(pos, 1.0);
+  vec2 moments = texture(uLightShadowMap, (shadowPos.xy / shadowPos.w) * 0.5 + 0.5).rg;
+  float depth = -(uLight.viewMatrix * vec4(pos, 1.0)).z;
+  if (depth <= moments.x)
+    return 1.0;
+
+  float variance = max(moments.y - moments.x * moments.x, 1e-6);
+  float delta = depth - moments.x;
+  float pMax = variance / (variance + delta * delta);
+  // Cut the tail of the bound, which lights the regions behind overlapping occluders.
+  return clamp((pMax - uVSMBleedReduction) / (1.0 - uVSMBleedReduction), 0.0, 1.0);
+}
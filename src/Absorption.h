@@ -4,16 +4,21 @@
 
 #include "MathDefines.h"
 
+#include <cmath>
+
+// Scalar reference of the chromophore absorption. The renderer uses the tabulated version of
+// skin/SpectralSkinLUT, which shares absorb().
+
 namespace sss {
 
-float transmissionForWavelength(float wavelength) {
+inline float transmissionForWavelength(float wavelength) {
   const float x = wavelength;
   const float val =
     ((float)(-0.00000155 * (x * x * x)) + 0.0024713f * (x * x) - 1.01845f * x + 127.489f) / 100.f;
   return val < 0.f ? 0.f : val > 1.f ? 1.f : val; // result between 0 and 1
 }
 
-Vec3f absorb(const Vec3f& color, const float wavelength) {
+inline Vec3f absorb(const Vec3f& color, const float wavelength) {
   if (wavelength >= 380.f && wavelength < 410.f) {
     return color * Vec3f(0.6f - 0.41f * ((410.f - wavelength) / 30.f), 0.f,
                          0.39f + 0.6f * ((410.f - wavelength) / 30.f));
@@ -36,24 +41,24 @@ Vec3f absorb(const Vec3f& color, const float wavelength) {
   }
 }
 
-long double eumelaninAbsorbtion(const float lambda) {
+inline long double eumelaninAbsorbtion(const float lambda) {
   return 6.6 * powl(10.0, 11.0) * powl(lambda, -3.33);
 }
 
-long double pheomelaninAbsorbtion(const float lambda) {
+inline long double pheomelaninAbsorbtion(const float lambda) {
   return 2.9 * powl(10.0, 15.0) * powl(lambda, -4.75);
 }
 
-long double skinBaseAbsorption(const float lambda) {
+inline long double skinBaseAbsorption(const float lambda) {
   return 7.84 * powl(10.0, 8.0) * powl(lambda, -3.255);
 }
 
 // spectral absorption of epidermis
-long double specAbsE(const float lambda // wavelength
-                     ,
-                     const float Vm // melanin volume fraction
-                     ,
-                     const float PhiM // melanin types ratio
+inline long double specAbsE(const float lambda // wavelength
+                            ,
+                            const float Vm // melanin volume fraction
+                            ,
+                            const float PhiM // melanin types ratio
 ) {
   long double MuA_eu = eumelaninAbsorbtion(lambda);
   long double MuA_ph = pheomelaninAbsorbtion(lambda);
@@ -64,14 +69,14 @@ long double specAbsE(const float lambda // wavelength
   return MuEpiderm;
 }
 
-long double oxyHaemoglobinAbsorption(const float lambda) {
+inline long double oxyHaemoglobinAbsorption(const float lambda) {
   long double Whb = 64500.0;     // Molar weight of Haemoglobin
   long double Phb = 150.0;       // haemoglobin Concentration
   long double Epsi_hbo2 = 818.0; // Oxy-Haemoglobin Extinction
   return 2.303 * ((Phb * Epsi_hbo2) / Whb);
 }
 
-long double deoxyHaemoglobinAbsorption(const float lambda) {
+inline long double deoxyHaemoglobinAbsorption(const float lambda) {
   long double Whb = 64500.0;   // Molar weight of Haemoglobin
   long double Phb = 150.0;     // haemoglobin Concentration
   long double Epsi_hb = 818.0; // Deoxy-Haemoglobin Extinction
@@ -79,11 +84,11 @@ long double deoxyHaemoglobinAbsorption(const float lambda) {
 }
 
 // spectral absorption of dermis
-long double specAbsD(const float lambda // wavelength
-                     ,
-                     const float Vb // blood volume fraction
-                     ,
-                     const float PhiH // haemoglobin types ratio
+inline long double specAbsD(const float lambda // wavelength
+                            ,
+                            const float Vb // blood volume fraction
+                            ,
+                            const float PhiH // haemoglobin types ratio
 ) {
   long double MuA_hb = deoxyHaemoglobinAbsorption(lambda);
   long double MuA_hbo2 = deoxyHaemoglobinAbsorption(lambda);
@@ -96,7 +101,7 @@ long double specAbsD(const float lambda // wavelength
 }
 
 // reduced scattering coefficient of human skin
-long double scatCoeff(const float lambda // wavelength
+inline long double scatCoeff(const float lambda // wavelength
 ) {
   long double alpha = 36.4;   // scaling factor
   long double rayScat = 0.48; // Rayleigh scattering
@@ -108,7 +113,8 @@ long double scatCoeff(const float lambda // wavelength
 
 //####################################################################################
 
-long double absorpCoeff(float mu_oxy, float mu_deoxy, float mu_fat, float mu_water, float lambda, float B, float S, float F, float W, float M) {
+inline long double absorpCoeff(float mu_oxy, float mu_deoxy, float mu_fat, float mu_water,
+                               float lambda, float B, float S, float F, float W, float M) {
   long double mu_melanosome = 519.0 * pow(lambda / 500.0, -3.0);
   mu_oxy = 2.303 * mu_oxy * (B / (64500.0));
   mu_deoxy = 2.303 * mu_deoxy * (B / (64500.0));
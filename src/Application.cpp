@@ -82,6 +82,7 @@ void AppContext::start(const char* name, int w, int h) {
 
     renderUI();
     SDL_GL_SwapWindow(m_window);
+    m_app.frameSwapped();
   }
 }
 
@@ -28,6 +28,8 @@ public:
   virtual void endFrame() {}
   virtual void renderFrame() {}
   virtual void renderUI() {}
+  // After the frame has been handed to the window system.
+  virtual void frameSwapped() {}
 
   virtual void processEvent(const SDL_Event& e) {}
 };
@@ -6,10 +6,26 @@
 #include "model/MaterialMeshModel.h"
 #include "model/QuadMesh.h"
 #include "shader/ShaderProgram.h"
+#include "skin/BurleyKernel.h"
+#include "skin/PreIntegratedLUT.h"
+#include "skin/SeparableKernel.h"
+#include "skin/SpecularLUT.h"
+#include "skin/SpectralSkinLUT.h"
+#include "skin/TransmittanceLUT.h"
+#include "utils/FileCache.h"
+#include "utils/GPUTimer.h"
 #include "utils/Image.h"
-
+#include "utils/SphericalHarmonics.h"
+#include "utils/ThreadPool.h"
+#include "utils/UploadQueue.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <map>
 
 #define ARRAY_LENGTH(arr) (sizeof(arr) / sizeof(arr[0]))
 
@@ -26,21 +42,98 @@ constexpr int AppH = 900;
 #endif
 
 std::string ShaderProgram::s_shadersDir = SSS_ASSET_DIR "/shaders/";
+// The radiance map is not tracked, see the README. The pre-blurred map next to it is, it is enough
+// for the irradiance but makes for a blurry skybox.
 const std::string EnvColorMapPath = SSS_ASSET_DIR "/maps/env/Siggraph2007_UpperFloor_REF.hdr";
-const std::string EnvIrradianceMapPath = SSS_ASSET_DIR "/maps/env/Siggraph2007_UpperFloor_Env.hdr";
-
-constexpr GLsizei EnvColorSize = 2048;
-constexpr GLsizei EnvIrradianceSize = 128;
+const std::string EnvFallbackMapPath = SSS_ASSET_DIR "/maps/env/Siggraph2007_UpperFloor_Env.hdr";
+const std::string CacheDir = SSS_ASSET_DIR "/cache";
+
+// Largest face size of the skybox cube map, it otherwise follows the env map. The whole chain is
+// converted and cached once, only the levels from the one the viewport needs are allocated.
+constexpr GLsizei MaxEnvColorSize = 2048;
+// GROUP_SIZE in env-to-cube-map.comp.
+constexpr GLuint EnvCubeMapGroupSize = 8;
+// Bump when the conversion changes, to invalidate the cached cube maps.
+constexpr uint32_t EnvCacheVersion = 3;
 constexpr GLsizei ShadowMapSize = 1024;
+// GL time given to the loaded assets each frame, see UploadQueue::run().
+constexpr float UploadBudgetMs = 4.0f;
+// Bytes of the converted cube map copied to the cache each frame, see pollEnvReadback().
+constexpr size_t EnvReadbackChunkSize = 8 << 20;
+// Block-compress the color, normal and single-channel maps, see TextureUsage.
+constexpr bool CompressTextures = true;
+
+// Uniform block bindings.
+constexpr GLuint BlurKernelBinding = 0;
+
+// Shader storage block bindings.
+constexpr GLuint TileListsBinding = 0;
+constexpr GLuint SceneLightsBinding = 1;
+
+// Must match GROUP_SIZE in sss-blur.comp.
+constexpr GLuint BlurComputeGroupSize = 128;
+
+// Clear value of the blur inputs, which keep the linear view depth in alpha. Far enough to fail
+// the depth rejection, must match BACKGROUND_DEPTH in sss-blur.comp.
+constexpr GLfloat BlurBackground[4] = {0.0f, 0.0f, 0.0f, 1.0e4f};
+
+// Must match TILE_SIZE in sss-classify-tiles.comp and tile.vert.
+constexpr GLsizei SSSTileSize = 16;
+
+// Head of the TileLists buffer, see sss-classify-tiles.comp.
+struct DrawArraysIndirectCommand {
+  GLuint count = 0;
+  GLuint instanceCount = 0;
+  GLuint first = 0;
+  GLuint baseInstance = 0;
+};
+
+// Must match LIGHT_* in light-culling.comp.
+enum class SceneLightType : int { Point, Spot, Directional };
+
+// Std430 layout of the SceneLights buffer, see scene-lights.glsl.
+struct SceneLight {
+  Vec4f positionRange;
+  Vec4f directionType;
+  Vec4f color;
+  Vec4f spotCosines;
+};
+
+// Must match MAX_LIGHTS_PER_TILE in light-culling.comp, no tile can overflow its list.
+constexpr int MaxSceneLights = 64;
+
+enum PassTimer : size_t {
+  ShadowPassTimer,
+  GBufPassTimer,
+  LightCullingPassTimer,
+  TileClassificationPassTimer,
+  BlurPassTimer,
+  MainPassTimer,
+  FinalOutputPassTimer,
+  NumPassTimers
+};
+
+constexpr const char* PassTimerNames[NumPassTimers] = {
+  "Shadow", "G-Buffer", "Scene lights", "Tiles", "Blur", "Main", "Final output"};
 
 struct Light {
   float pitch = 0.0f;
   float yaw = 0.0f;
   float distance = 1.0f;
+  static constexpr float MinNear = 0.01f;
+
   float near = 0.1f;
   float far = 5.0f;
   float fovy = 45.0f;
 
+  // Fit the frustum to the world-space bounds of the scene instead of using near, far and fovy.
+  bool fitToBounds = true;
+  AABB bounds;
+
+  // Planes of proj, the fitted ones or near and far.
+  float projNear = near;
+  float projFar = far;
+
   Vec3f color = Vec3f(1.0f);
   float intensity = 1.0f;
   Vec3f position = {};
@@ -55,10 +148,44 @@ struct Light {
 
     const Vec3f up(0.0f, 1.0f, 0.0f);
     view = glm::lookAt(position, position + direction, up);
-    proj = glm::perspective(glm::radians(fovy), 1.0f, near, far);
+    if (!fitToBounds || !fitFrustum()) {
+      projNear = near;
+      projFar = far;
+      proj = glm::perspective(glm::radians(fovy), 1.0f, near, far);
+    }
   }
 
 private:
+  // Off-center frustum tightly around the corners of the bounds, the whole shadow map then covers
+  // the scene. Fails when the light is inside of the bounds.
+  bool fitFrustum() {
+    if (bounds.isEmpty())
+      return false;
+
+    Vec2f minSlope(Inf);
+    Vec2f maxSlope(-Inf);
+    float zNear = Inf;
+    float zFar = 0.0f;
+    for (int i = 0; i < 8; ++i) {
+      const Vec3f p = Vec3f(view * Vec4f(bounds.corner(i), 1.0f));
+      const float z = -p.z;
+      if (z <= MinNear)
+        return false;
+
+      minSlope = glm::min(minSlope, Vec2f(p) / z);
+      maxSlope = glm::max(maxSlope, Vec2f(p) / z);
+      zNear = glm::min(zNear, z);
+      zFar = glm::max(zFar, z);
+    }
+
+    // Keep the closest and farthest points off the clip planes.
+    projNear = zNear * 0.99f;
+    projFar = zFar * 1.01f;
+    proj = glm::frustum(minSlope.x * projNear, maxSlope.x * projNear, minSlope.y * projNear,
+                        maxSlope.y * projNear, projNear, projFar);
+    return true;
+  }
+
   void updatePosition() {
     float pitchRad = glm::radians(pitch);
     float yawRad = glm::radians(yaw);
@@ -72,6 +199,22 @@ private:
 
 struct ShadowUniforms {
   GLint lightMVP = GL_INVALID_INDEX;
+  GLint lightMV = GL_INVALID_INDEX;
+};
+
+enum class ShadowMode : int {
+  // Nearest linear depth, bilinearly filtered by the transmittance lookup.
+  LinearDepth,
+  // Depth moments blurred by a separable gaussian: pre-filtered thickness for the transmittance,
+  // and Chebyshev shadowing of the direct lighting.
+  Variance
+};
+
+constexpr const char* ShadowModeNames[] = {"Linear depth", "Variance"};
+
+struct ShadowBlurUniforms {
+  GLint step = GL_INVALID_INDEX;
+  GLint radius = GL_INVALID_INDEX;
 };
 
 struct SkyBoxUniforms {
@@ -80,21 +223,47 @@ struct SkyBoxUniforms {
 };
 
 struct LightUniforms {
-  GLint position = GL_INVALID_INDEX;
   GLint direction = GL_INVALID_INDEX;
   GLint color = GL_INVALID_INDEX;
   GLint intensity = GL_INVALID_INDEX;
   GLint VPMatrix = GL_INVALID_INDEX;
+  GLint viewMatrix = GL_INVALID_INDEX;
+};
+
+struct LightCullingUniforms {
+  GLint numLights = GL_INVALID_INDEX;
+  GLint viewMatrix = GL_INVALID_INDEX;
+  GLint invViewMatrix = GL_INVALID_INDEX;
+  GLint projScale = GL_INVALID_INDEX;
+};
+
+struct TileUniforms {
+  GLint tileOffset = GL_INVALID_INDEX;
+  GLint viewportSize = GL_INVALID_INDEX;
 };
 
 struct GBufUniforms {
   GLint modelMatrix = GL_INVALID_INDEX;
   GLint MVPMatrix = GL_INVALID_INDEX;
   GLint normalMatrix = GL_INVALID_INDEX;
+  GLint viewMatrix = GL_INVALID_INDEX;
   LightUniforms light;
   GLint gammaCorrect = GL_INVALID_INDEX;
   GLint useDynamicSkinColor = GL_INVALID_INDEX;
+  GLint skinAlbedoLUTCoord = GL_INVALID_INDEX;
   GLint useEnvIrradiance = GL_INVALID_INDEX;
+  GLint envIrradianceSH = GL_INVALID_INDEX;
+  GLint usePreIntegratedSkin = GL_INVALID_INDEX;
+  GLint preIntegratedMaxCurvature = GL_INVALID_INDEX;
+  GLint curvatureScale = GL_INVALID_INDEX;
+  GLint specularIntensity = GL_INVALID_INDEX;
+  GLint useShadows = GL_INVALID_INDEX;
+  GLint VSMBleedReduction = GL_INVALID_INDEX;
+  GLint numSceneLights = GL_INVALID_INDEX;
+};
+
+// The spectral loop of skin-albedo.comp, only kept as a reference for the benchmark.
+struct SkinAlbedoUniforms {
   GLint B = GL_INVALID_INDEX;
   GLint S = GL_INVALID_INDEX;
   GLint F = GL_INVALID_INDEX;
@@ -102,14 +271,41 @@ struct GBufUniforms {
   GLint M = GL_INVALID_INDEX;
 };
 
+struct SpectralSkinBenchmark {
+  float SIMDMs = 0.0f;
+  float scalarMs = 0.0f;
+  float GPUMs = 0.0f;
+  // Largest channel difference between the LUT and skin-albedo.comp.
+  float LUTError = 0.0f;
+  bool valid = false;
+};
+
 struct MainUniforms {
   LightUniforms light;
+  GLint invViewProj = GL_INVALID_INDEX;
+  GLint cameraPosition = GL_INVALID_INDEX;
   GLint enableTransmittance = GL_INVALID_INDEX;
   GLint enableBlur = GL_INVALID_INDEX;
+  GLint enableSpecular = GL_INVALID_INDEX;
   GLint transmittanceStrength = GL_INVALID_INDEX;
   GLint SSSWeight = GL_INVALID_INDEX;
   GLint SSSWidth = GL_INVALID_INDEX;
   GLint SSSNormalBias = GL_INVALID_INDEX;
+  GLint blurScale = GL_INVALID_INDEX;
+  GLint textureSpaceDiffusion = GL_INVALID_INDEX;
+  GLint transmittanceMaxThickness = GL_INVALID_INDEX;
+  GLint useShadows = GL_INVALID_INDEX;
+  GLint VSMBleedReduction = GL_INVALID_INDEX;
+  TileUniforms tile;
+};
+
+// Programs of main.frag, one per kind of draw.
+enum MainVariant : size_t {
+  MainVariantFullScreen,
+  // Drawn over the tiles listed by sss-classify-tiles.comp.
+  MainVariantEdgeTiles,
+  MainVariantInteriorTiles,
+  NumMainVariants
 };
 
 struct BlurUniforms {
@@ -119,8 +315,125 @@ struct BlurUniforms {
   GLint falloff = GL_INVALID_INDEX;
   GLint strength = GL_INVALID_INDEX;
   GLint photonPathLength = GL_INVALID_INDEX;
+  GLint direction = GL_INVALID_INDEX;
+  GLint resolutionScale = GL_INVALID_INDEX;
+  GLint tapStride = GL_INVALID_INDEX;
+  GLint tapOffset = GL_INVALID_INDEX;
+  GLint rotation = GL_INVALID_INDEX;
+  TileUniforms tile;
+};
+
+struct BlurTemporalUniforms {
+  GLint invViewProj = GL_INVALID_INDEX;
+  GLint prevViewProj = GL_INVALID_INDEX;
+  GLint historyValid = GL_INVALID_INDEX;
+  GLint maxFrames = GL_INVALID_INDEX;
+};
+
+struct BlurDownsampleUniforms {
+  GLint scale = GL_INVALID_INDEX;
+};
+
+// Shader variants of sss-blur.frag, combined as bit flags.
+enum BlurVariant : unsigned {
+  // Evaluate the kernel for every fragment instead of reading the cached one, only kept for
+  // comparing timings.
+  BlurVariantPerFragmentKernel = 1 << 0,
+  // Blur in a single direction, see BlurMode::TwoPass.
+  BlurVariantSeparablePass = 1 << 1,
+  // sss-blur.comp instead of sss-blur.frag, see BlurBackend::Compute.
+  BlurVariantCompute = 1 << 2,
+  // Drawn over the classified tiles instead of a full-screen quad.
+  BlurVariantTiles = 1 << 3,
+  // Radial blur with the Burley kernel, see DiffusionEngine::Burley.
+  BlurVariantBurley = 1 << 4,
+};
+
+struct BlurProgram {
+  ShaderProgram program;
+  BlurUniforms uniforms;
+  bool valid = false;
+};
+
+enum class BlurMode : int {
+  // Horizontal then vertical blur in the same fragment, the vertical pass never sees the
+  // horizontally blurred neighbors.
+  SinglePass,
+  // Horizontal blur into an intermediate target, then vertical blur of that target.
+  TwoPass
+};
+
+constexpr const char* BlurModeNames[] = {"Single pass", "Two passes"};
+
+enum class DiffusionEngine : int {
+  // Jimenez's separable sum of gaussians, see SeparableKernel.
+  Separable,
+  // Burley's normalized diffusion, sampled radially in a single pass, see BurleyKernel.
+  Burley
+};
+
+constexpr const char* DiffusionEngineNames[] = {"Separable (gaussians)", "Burley"};
+
+enum class BlurBackend : int {
+  // Full-screen draws masked by the stencil, see BlurMode.
+  Fragment,
+  // Two dispatches reading tiles cached in shared memory, always separable.
+  Compute
+};
+
+constexpr const char* BlurBackendNames[] = {"Fragment", "Compute"};
+
+// The diffusion is low-frequency, so the blur can run on downsampled inputs and be upsampled
+// by main.frag.
+enum class BlurResolution : int { Full, Half, Quarter };
+
+constexpr const char* BlurResolutionNames[] = {"Full", "1/2", "1/4"};
+
+struct TileClassificationUniforms {
+  GLint maxTiles = GL_INVALID_INDEX;
+};
+
+enum class SkinDiffusionMode : int {
+  // Blur of the irradiance, see blurPass().
+  ScreenSpace,
+  // Diffusion looked up in the G-buffer pass, see PreIntegratedLUT. No blur pass.
+  PreIntegrated,
+  // Blur of the irradiance in the UV atlas, see textureSpaceDiffusionPass().
+  TextureSpace
+};
+
+constexpr const char* SkinDiffusionModeNames[] = {"Screen-space blur", "Pre-integrated",
+                                                  "Texture-space"};
+
+struct TSDBlurUniforms {
+  GLint direction = GL_INVALID_INDEX;
+  GLint sigma = GL_INVALID_INDEX;
+  GLint weight = GL_INVALID_INDEX;
 };
 
+constexpr GLsizei TSDAtlasSize = 1024;
+// The atlas is assumed to cover 50cm by 50cm of skin, see sss-blur.frag.
+constexpr float TSDTexelSizeMM = 500.0f / (float)TSDAtlasSize;
+
+struct TSDGaussian {
+  float variance; // mm^2
+  Vec3f weight;
+};
+
+// Sum of gaussians fitted to the three-layer skin profile, from "Efficient Rendering of Human
+// Skin" (d'Eon et al.).
+const TSDGaussian TSDGaussians[] = {
+  {0.0064f, Vec3f(0.233f, 0.455f, 0.649f)}, {0.0484f, Vec3f(0.1f, 0.336f, 0.344f)},
+  {0.187f, Vec3f(0.118f, 0.198f, 0.0f)},    {0.567f, Vec3f(0.113f, 0.007f, 0.007f)},
+  {1.99f, Vec3f(0.358f, 0.004f, 0.0f)},     {7.41f, Vec3f(0.078f, 0.0f, 0.0f)}};
+
+struct GBufVisUniforms {
+  GLint invViewProj = GL_INVALID_INDEX;
+  GLint target = GL_INVALID_INDEX;
+};
+
+constexpr const char* GBufVisTargetNames[] = {"Position", "UV", "Normal", "Albedo", "Irradiance"};
+
 struct FinalOutputUniforms {
   GLint gammaCorrect = GL_INVALID_INDEX;
   GLint exposure = GL_INVALID_INDEX;
@@ -132,31 +445,38 @@ public:
     m_window = window;
     m_viewportW = w;
     m_viewportH = h;
+    m_initTime = std::chrono::steady_clock::now();
 
     m_cube.init();
+    initPlaceholderTex();
     m_quad.init();
+    // The tiles are expanded from the tile lists, no vertex attribute is needed.
+    glCreateVertexArrays(1, &m_tileVA);
 
     initShadowFB();
-    initEnvFB();
+    initTSDFBs();
     if (!updateMainFBs()) {
       std::cout << "Failed to init main framebuffers" << std::endl;
       return false;
     }
 
-    if (!initMaps()) {
-      std::cout << "Failed to init maps" << std::endl;
+    if (!initPrograms()) {
+      std::cout << "Failed to init programs" << std::endl;
       return false;
     }
 
-    if (!renderEnvCubeMaps()) {
-      std::cout << "Failed to render env cube maps" << std::endl;
+    initBlurKernel();
+    initPreIntegratedLUT();
+    initTransmittanceLUT();
+    initSpecularLUT();
+    initSceneLights();
+    if (!initSkinAlbedoLUT()) {
+      std::cout << "Failed to init skin albedo LUT" << std::endl;
       return false;
     }
 
-    if (!initPrograms()) {
-      std::cout << "Failed to init programs" << std::endl;
-      return false;
-    }
+    for (GPUTimer& timer : m_passTimers)
+      timer.init();
 
     m_cam.setFovy(60.0f);
     m_cam.setLookAt(Vec3f(1.0f, 0.0f, 0.0f));
@@ -164,26 +484,63 @@ public:
     m_cam.setScreenSize(AppW, AppH);
     m_cam.setSpeed(0.05f);
 
-    m_model.load("james", SSS_ASSET_DIR "/models/james/james_hi.obj");
     m_model.setTransform(glm::scale(m_model.transform(), Vec3f(0.01f)));
 
     m_light.yaw = 90.0f;
     m_light.position = Vec3f(0.0f, 0.0f, 1.0f);
-    m_light.update();
+    updateLight();
+
+    // The window opens right away, the assets are swapped in as they become resident.
+    requestModel();
+    requestMaps();
+    requestEnvCubeMaps();
     return true;
   }
 
   void cleanup() override {
     m_shadowProgram.release();
+    m_shadowBlurProgram.release();
     m_GBufProgram.release();
-    m_mainProgram.release();
-    m_blurProgram.release();
+    for (ShaderProgram& program : m_mainPrograms)
+      program.release();
+    m_tileClassificationProgram.release();
+    m_lightCullingProgram.release();
+    glDeleteBuffers(1, &m_sceneLightsBuffer);
+    m_sceneLightsBuffer = 0;
+    glDeleteVertexArrays(1, &m_tileVA);
+    m_tileVA = 0;
+    m_blurPrograms.clear();
+    m_blurDownsampleProgram.release();
+    m_blurTemporalProgram.release();
+    m_TSDIrradianceProgram.release();
+    m_TSDBlurProgram.release();
+    glDeleteBuffers(1, &m_blurKernelUBO);
+    glDeleteBuffers(1, &m_burleyKernelUBO);
+    glDeleteTextures(1, &m_preIntegratedLUTTex);
+    m_preIntegratedLUTTex = 0;
+    glDeleteTextures(1, &m_transmittanceLUTTex);
+    m_transmittanceLUTTex = 0;
+    glDeleteTextures(1, &m_specularLUTTex);
+    m_specularLUTTex = 0;
+    m_skinAlbedoProgram.release();
+    glDeleteTextures(1, &m_skinAlbedoLUTTex);
+    m_skinAlbedoLUTTex = 0;
+    m_blurKernelUBO = 0;
+    m_burleyKernelUBO = 0;
+    for (GPUTimer& timer : m_passTimers)
+      timer.release();
     m_finalOutputProgram.release();
+    m_GBufVisProgram.release();
     m_model.release();
     m_quad.release();
     m_kernelSizeTex.release();
+    m_modelSkinColorlessTex.release();
     m_modelSkinParamMap.release();
+    m_modelSkinColorLookupTex.release();
     m_paramTex.release();
+    glDeleteTextures(1, &m_placeholderTex);
+    m_placeholderTex = 0;
+    releaseEnvReadback();
     releaseFBs(true);
   }
 
@@ -194,37 +551,110 @@ public:
 
 public:
   void beginFrame() override {
+    runUploads();
+
     if (m_viewportNeedsUpdate) {
       if (!updateMainFBs()) {
         std::cout << "Failed to update main framebuffers" << std::endl;
         m_keepRunning = false;
       }
       m_viewportNeedsUpdate = false;
+    } else if (m_blurFBResolution != m_blurResolution) {
+      releaseBlurFB();
+      if (!initBlurFB()) {
+        std::cout << "Failed to update blur framebuffers" << std::endl;
+        m_keepRunning = false;
+      }
     }
 
+    // Reallocated from the cached chain, the current cube map is drawn until then.
+    if (m_envColorCubeMap && !m_envRequestPending && !m_envReadback.buffer &&
+        envBaseLevelForViewport() != m_envBaseLevel)
+      requestEnvCubeMaps();
+
+    updateBlurKernel();
+    if (m_useDynamicSkinColor && (m_skinAlbedoRequestedF != m_F || m_skinAlbedoRequestedW != m_W))
+      requestSkinAlbedoLUT();
+    if (m_skinDiffusionMode == SkinDiffusionMode::PreIntegrated &&
+        (m_preIntegratedRequestedFalloff != m_falloff ||
+         m_preIntegratedRequestedMaxCurvature != preIntegratedMaxCurvature()))
+      requestPreIntegratedLUT();
+    if (m_specularLUT.roughness() != m_specularRoughness)
+      updateSpecularLUT();
+    if (m_numSceneLights > 0)
+      updateSceneLights();
+
     glEnable(GL_DEPTH_TEST);
     glClearColor(0.05f, 0.05f, 0.05f, 1.0f);
   }
 
   void renderFrame() override {
-    shadowPass();
-    GBufPass();
+    {
+      ScopedGPUTimer timer(m_passTimers[ShadowPassTimer]);
+      shadowPass();
+    }
+    {
+      ScopedGPUTimer timer(m_passTimers[GBufPassTimer]);
+      GBufPass();
+    }
+    if (m_numSceneLights > 0) {
+      ScopedGPUTimer timer(m_passTimers[LightCullingPassTimer]);
+      lightCullingPass();
+    }
+
+    if (m_useTiles) {
+      ScopedGPUTimer timer(m_passTimers[TileClassificationPassTimer]);
+      tileClassificationPass();
+    }
 
-    if (m_enableBlur)
+    if (m_skinDiffusionMode == SkinDiffusionMode::TextureSpace) {
+      ScopedGPUTimer timer(m_passTimers[BlurPassTimer]);
+      textureSpaceDiffusionPass();
+    } else if (blurEnabled()) {
+      ScopedGPUTimer timer(m_passTimers[BlurPassTimer]);
       blurPass();
+      if (m_useTemporalBlur)
+        blurTemporalPass();
+    }
+    // The history is stale after any frame that did not accumulate into it.
+    if (!m_useTemporalBlur || !blurEnabled())
+      m_blurHistoryValid = false;
 
-    mainPass();
-    finalOutputPass();
+    {
+      ScopedGPUTimer timer(m_passTimers[MainPassTimer]);
+      mainPass();
+    }
+    {
+      ScopedGPUTimer timer(m_passTimers[FinalOutputPassTimer]);
+      finalOutputPass();
+    }
+
+    if (m_showConfig && m_showGBufVis)
+      GBufVisPass();
   }
 
   void endFrame() override { glDisable(GL_DEPTH_TEST); }
 
+  void frameSwapped() override {
+    if (m_loggedFirstFrame)
+      return;
+
+    const std::chrono::duration<float, std::milli> elapsed =
+      std::chrono::steady_clock::now() - m_initTime;
+    std::cout << "First frame after " << elapsed.count() << " ms" << std::endl;
+    m_loggedFirstFrame = true;
+  }
+
 public:
   void renderUI() override {
     if (ImGui::BeginMainMenuBar()) {
       ImGui::Checkbox("Show config", &m_showConfig);
       ImGui::Separator();
       ImGui::Text("%.2f fps", 1 / m_avgDeltaT);
+      if (m_numPendingLoads > 0) {
+        ImGui::Separator();
+        ImGui::Text("Loading %d asset(s)", m_numPendingLoads);
+      }
       ImGui::EndMainMenuBar();
     }
 
@@ -253,28 +683,74 @@ public:
       ImGui::SliderFloat("Fat (F)", &m_F, 0.0f, 100.f);
       ImGui::SliderFloat("Water (W)", &m_W, 0.0f, 100.f);
       ImGui::SliderFloat("Melanosomes (M)", &m_M, 0.0f, 100.f);
+
+      if (ImGui::Button("Benchmark"))
+        benchmarkSpectralSkin();
+      if (m_spectralBenchmark.valid) {
+        ImGui::Text("LUT SIMD: %.2f ms", m_spectralBenchmark.SIMDMs);
+        ImGui::Text("LUT scalar: %.2f ms", m_spectralBenchmark.scalarMs);
+        ImGui::Text("GPU per pixel loop: %.2f ms", m_spectralBenchmark.GPUMs);
+        ImGui::Text("LUT error: %.4f", m_spectralBenchmark.LUTError);
+      }
     }
 
     if (ImGui::CollapsingHeader("SSS")) {
+      ImGui::Combo("Diffusion", (int*)&m_skinDiffusionMode, SkinDiffusionModeNames,
+                   ARRAY_LENGTH(SkinDiffusionModeNames));
+      if (m_skinDiffusionMode == SkinDiffusionMode::PreIntegrated) {
+        ImGui::SliderFloat3("Falloff", glm::value_ptr(m_falloff), 0.0f, 1.0f);
+        ImGui::SliderFloat("Curvature scale (mm/unit)", &m_curvatureScale, 100.0f, 5000.0f);
+      }
+
       ImGui::Checkbox("Transmittance", &m_enableTransmittance);
-      ImGui::Checkbox("Blur", &m_enableBlur);
+      if (m_skinDiffusionMode != SkinDiffusionMode::PreIntegrated)
+        ImGui::Checkbox("Blur", &m_enableBlur);
+      ImGui::Checkbox("Tile classification", &m_useTiles);
 
-      if (m_enableBlur || m_enableTransmittance)
+      if (blurEnabled() || m_enableTransmittance)
         ImGui::SliderFloat("Effect width", &m_SSSWidth, 0.001f, 0.1f);
 
+      ImGui::Checkbox("Specular", &m_enableSpecular);
+      if (m_enableSpecular) {
+        ImGui::SliderFloat("Roughness", &m_specularRoughness, 0.05f, 1.0f);
+        ImGui::SliderFloat("Specular intensity", &m_specularIntensity, 0.0f, 1.0f);
+      }
+
       if (m_enableTransmittance) {
         ImGui::Text("Transmittance");
         ImGui::SliderFloat("Strength", &m_transmittanceStrength, 0.0f, 1.0f);
         ImGui::SliderFloat("Normal bias", &m_SSSNormalBias, 0.0f, 1.0f);
       }
 
-      if (m_enableBlur) {
+      if (blurEnabled()) {
         ImGui::Text("Blur");
+        ImGui::Combo("Engine", (int*)&m_diffusionEngine, DiffusionEngineNames,
+                     ARRAY_LENGTH(DiffusionEngineNames));
+        const bool separable = m_diffusionEngine == DiffusionEngine::Separable;
+        if (separable) {
+          ImGui::Combo("Backend", (int*)&m_blurBackend, BlurBackendNames,
+                       ARRAY_LENGTH(BlurBackendNames));
+          if (m_blurBackend == BlurBackend::Fragment)
+            ImGui::Combo("Mode", (int*)&m_blurMode, BlurModeNames, ARRAY_LENGTH(BlurModeNames));
+        }
+        ImGui::Combo("Resolution", (int*)&m_blurResolution, BlurResolutionNames,
+                     ARRAY_LENGTH(BlurResolutionNames));
         ImGui::SliderFloat("Weight", &m_SSSWeight, 0.0f, 1.0f);
-        ImGui::SliderInt("Kernel size", &m_nSamples, 10, 50);
+        if (separable)
+          ImGui::SliderInt("Kernel size", &m_nSamples, 10, 50);
+        else
+          ImGui::SliderInt("Taps", &m_nBurleySamples, 4, 32);
         ImGui::SliderFloat3("Falloff", glm::value_ptr(m_falloff), 0.0f, 1.0f);
         ImGui::SliderFloat3("Strength", glm::value_ptr(m_strength), 0.0f, 1.0f);
         ImGui::SliderFloat("Path Length", &m_photonPathLength, 1.0f, 20.0f);
+        if (separable && m_blurBackend == BlurBackend::Fragment)
+          ImGui::Checkbox("Per-fragment kernel (reference)", &m_usePerFragmentKernel);
+
+        ImGui::Checkbox("Temporal accumulation", &m_useTemporalBlur);
+        if (m_useTemporalBlur) {
+          ImGui::SliderInt("Taps per frame", &m_temporalTapsPerFrame, 2, 8);
+          ImGui::SliderInt("History length", &m_temporalMaxFrames, 4, 64);
+        }
       }
     }
 
@@ -282,54 +758,116 @@ public:
       ImGui::SliderFloat("Pitch", &m_light.pitch, -89.0f, 89.0f);
       ImGui::SliderFloat("Yaw", &m_light.yaw, -180.0f, 180.0f);
       ImGui::SliderFloat("Distance", &m_light.distance, 0.01f, 1.5f);
-      ImGui::SliderFloat("Far plane", &m_light.far, m_light.near + 0.001f, 7.5f);
-      ImGui::SliderFloat("Fovy", &m_light.fovy, 5.0f, 90.0f);
+      ImGui::Checkbox("Fit frustum to model", &m_light.fitToBounds);
+      if (!m_light.fitToBounds) {
+        ImGui::SliderFloat("Far plane", &m_light.far, m_light.near + 0.001f, 7.5f);
+        ImGui::SliderFloat("Fovy", &m_light.fovy, 5.0f, 90.0f);
+      }
       ImGui::ColorPicker3("Color", glm::value_ptr(m_light.color));
       ImGui::SliderFloat("Intensity", &m_light.intensity, 0.0f, 20.0f);
-      m_light.update();
+      updateLight();
+
+      ImGui::SliderInt("Scene lights", &m_numSceneLights, 0, MaxSceneLights);
+      if (m_numSceneLights > 0)
+        ImGui::SliderFloat("Scene light intensity", &m_sceneLightIntensity, 0.0f, 5.0f);
+
+      ImGui::Combo("Shadow map", (int*)&m_shadowMode, ShadowModeNames,
+                   ARRAY_LENGTH(ShadowModeNames));
+      if (m_shadowMode == ShadowMode::Variance) {
+        ImGui::SliderInt("Filter radius", &m_shadowBlurRadius, 1, 8);
+        ImGui::SliderFloat("Bleed reduction", &m_VSMBleedReduction, 0.0f, 0.9f);
+      }
 
       ImGui::Image((void*)(size_t)m_shadowDepthTex, {200, 200}, /*uv0=*/{0.0f, 1.0f},
                    /*uv1=*/{1.0f, 0.0f});
     }
 
     renderGBufVisualizerUI();
+    renderTimingsUI();
     ImGui::End();
   }
 
+  void renderTimingsUI() {
+    if (!ImGui::CollapsingHeader("Timings"))
+      return;
+
+    if (ImGui::BeginTable("Timings-table", 2, ImGuiTableFlags_SizingFixedFit)) {
+      float total = 0.0f;
+      for (size_t i = 0; i < NumPassTimers; ++i) {
+        // The timers are stale while their pass is disabled.
+        if ((i == BlurPassTimer && !blurEnabled()) ||
+            (i == TileClassificationPassTimer && !m_useTiles) ||
+            (i == LightCullingPassTimer && m_numSceneLights == 0))
+          continue;
+
+        ImGui::TableNextColumn();
+        ImGui::Text("%s", PassTimerNames[i]);
+        ImGui::TableNextColumn();
+        ImGui::Text("%.3f ms", m_passTimers[i].elapsedMs());
+        total += m_passTimers[i].elapsedMs();
+      }
+
+      ImGui::TableNextColumn();
+      ImGui::Text("Total");
+      ImGui::TableNextColumn();
+      ImGui::Text("%.3f ms", total);
+      ImGui::EndTable();
+    }
+  }
+
   void renderGBufVisualizerUI() {
-    GLuint textures[] = {m_GBufPosTex, m_GBufUVTex, m_GBufNormalTex, m_GBufAlbedoTex,
-                         m_GBufIrradianceTex};
-    constexpr unsigned int NumTextures = ARRAY_LENGTH(textures);
+    constexpr unsigned int NumTargets = ARRAY_LENGTH(GBufVisTargetNames);
+
+    m_showGBufVis = ImGui::CollapsingHeader("G-Buffer");
+    if (m_showGBufVis) {
+      const float pixels = (float)m_viewportW * (float)m_viewportH;
+      ImGui::Text("%d bytes/pixel, %.1f MiB", m_GBufBitsPerPixel / 8,
+                  pixels * (float)m_GBufBitsPerPixel / (8.0f * 1024.0f * 1024.0f));
 
-    if (ImGui::CollapsingHeader("G-Buffer")) {
       if (ImGui::BeginTable("GBuf-vis-header", 3, ImGuiTableFlags_SizingFixedFit)) {
         ImGui::TableNextColumn();
         if (ImGui::Button("Prev")) {
           if (m_GBufVisTextureIndex == 0)
-            m_GBufVisTextureIndex = NumTextures - 1;
+            m_GBufVisTextureIndex = NumTargets - 1;
           else
             m_GBufVisTextureIndex -= 1;
         }
 
         ImGui::TableNextColumn();
         if (ImGui::Button("Next"))
-          m_GBufVisTextureIndex = (m_GBufVisTextureIndex + 1) % NumTextures;
+          m_GBufVisTextureIndex = (m_GBufVisTextureIndex + 1) % NumTargets;
 
         ImGui::TableNextColumn();
-        ImGui::Text("%d/%d", m_GBufVisTextureIndex + 1, NumTextures);
+        ImGui::Text("%s (%d/%d)", GBufVisTargetNames[m_GBufVisTextureIndex],
+                    m_GBufVisTextureIndex + 1, NumTargets);
         ImGui::EndTable();
       }
 
+      // Decoded by GBufVisPass().
       const float scale = 2.0f;
-      ImGui::Image((void*)(size_t)textures[m_GBufVisTextureIndex], {160 * scale, 90 * scale},
+      ImGui::Image((void*)(size_t)m_GBufVisTex, {160 * scale, 90 * scale},
                    /*uv0=*/{0.0f, 1.0f}, /*uv1=*/{1.0f, 0.0f});
     }
   }
 
 private:
   bool initPrograms() {
-    return initShadowProgram() && initSkyBoxProgram() && initGBufProgram() && initMainProgram() &&
-           initBlurProgram() && initFinalOutputProgram();
+    return initShadowProgram() && initShadowBlurProgram() && initSkyBoxProgram() &&
+           initGBufProgram() && initMainProgram() && initBlurProgram() &&
+           initBlurDownsampleProgram() && initBlurTemporalProgram() && initTSDPrograms() &&
+           initTileClassificationProgram() && initFinalOutputProgram() && initGBufVisProgram() &&
+           initSkinAlbedoProgram() && initLightCullingProgram();
+  }
+
+  bool initGBufVisProgram() {
+    if (!m_GBufVisProgram.initVertexFragment("quad.vert", "g-buffer-vis.frag")) {
+      std::cout << "Failed to init GBuf visualizer program" << std::endl;
+      return false;
+    }
+
+    m_GBufVisUniforms.invViewProj = m_GBufVisProgram.getUniformLocation("uInvViewProj");
+    m_GBufVisUniforms.target = m_GBufVisProgram.getUniformLocation("uTarget");
+    return true;
   }
 
   bool initShadowProgram() {
@@ -339,6 +877,18 @@ private:
     }
 
     m_shadowUniforms.lightMVP = m_shadowProgram.getUniformLocation("uLightMVP");
+    m_shadowUniforms.lightMV = m_shadowProgram.getUniformLocation("uLightMV");
+    return true;
+  }
+
+  bool initShadowBlurProgram() {
+    if (!m_shadowBlurProgram.initVertexFragment("quad.vert", "shadow-blur.frag")) {
+      std::cout << "Failed to init shadow blur program" << std::endl;
+      return false;
+    }
+
+    m_shadowBlurUniforms.step = m_shadowBlurProgram.getUniformLocation("uStep");
+    m_shadowBlurUniforms.radius = m_shadowBlurProgram.getUniformLocation("uRadius");
     return true;
   }
 
@@ -359,55 +909,206 @@ private:
       return false;
     }
 
-    m_GBufUniforms.modelMatrix = m_GBufProgram.getUniformLocation("uModelMatrix");
-    m_GBufUniforms.MVPMatrix = m_GBufProgram.getUniformLocation("uMVPMatrix");
-    m_GBufUniforms.normalMatrix = m_GBufProgram.getUniformLocation("uNormalMatrix");
-    m_GBufUniforms.light.direction = m_GBufProgram.getUniformLocation("uLight.direction");
-    m_GBufUniforms.light.color = m_GBufProgram.getUniformLocation("uLight.color");
-    m_GBufUniforms.light.intensity = m_GBufProgram.getUniformLocation("uLight.intensity");
-    m_GBufUniforms.gammaCorrect = m_GBufProgram.getUniformLocation("uGammaCorrect");
-    m_GBufUniforms.useDynamicSkinColor = m_GBufProgram.getUniformLocation("uUseDynamicSkinColor");
-    m_GBufUniforms.useEnvIrradiance = m_GBufProgram.getUniformLocation("uUseEnvIrradiance");
-    m_GBufUniforms.B = m_GBufProgram.getUniformLocation("uB");
-    m_GBufUniforms.S = m_GBufProgram.getUniformLocation("uS");
-    m_GBufUniforms.F = m_GBufProgram.getUniformLocation("uF");
-    m_GBufUniforms.W = m_GBufProgram.getUniformLocation("uW");
-    m_GBufUniforms.M = m_GBufProgram.getUniformLocation("uM");
+    m_GBufUniforms = getGBufUniforms(m_GBufProgram);
     return true;
   }
 
-  bool initMainProgram() {
-    if (!m_mainProgram.initVertexFragment("quad.vert", "main.frag")) {
-      std::cout << "Failed to init main program" << std::endl;
+  // Also used to rasterize the irradiance in texture space.
+  static GBufUniforms getGBufUniforms(const ShaderProgram& program) {
+    GBufUniforms uniforms;
+    uniforms.modelMatrix = program.getUniformLocation("uModelMatrix");
+    uniforms.MVPMatrix = program.getUniformLocation("uMVPMatrix");
+    uniforms.normalMatrix = program.getUniformLocation("uNormalMatrix");
+    uniforms.viewMatrix = program.getUniformLocation("uViewMatrix");
+    uniforms.light.direction = program.getUniformLocation("uLight.direction");
+    uniforms.light.color = program.getUniformLocation("uLight.color");
+    uniforms.light.intensity = program.getUniformLocation("uLight.intensity");
+    uniforms.gammaCorrect = program.getUniformLocation("uGammaCorrect");
+    uniforms.useDynamicSkinColor = program.getUniformLocation("uUseDynamicSkinColor");
+    uniforms.skinAlbedoLUTCoord = program.getUniformLocation("uSkinAlbedoLUTCoord");
+    uniforms.useEnvIrradiance = program.getUniformLocation("uUseEnvIrradiance");
+    uniforms.envIrradianceSH = program.getUniformLocation("uEnvIrradianceSH");
+    uniforms.usePreIntegratedSkin = program.getUniformLocation("uUsePreIntegratedSkin");
+    uniforms.preIntegratedMaxCurvature = program.getUniformLocation("uPreIntegratedMaxCurvature");
+    uniforms.curvatureScale = program.getUniformLocation("uCurvatureScale");
+    uniforms.specularIntensity = program.getUniformLocation("uSpecularIntensity");
+    uniforms.light.VPMatrix = program.getUniformLocation("uLight.VPMatrix");
+    uniforms.light.viewMatrix = program.getUniformLocation("uLight.viewMatrix");
+    uniforms.useShadows = program.getUniformLocation("uUseShadows");
+    uniforms.VSMBleedReduction = program.getUniformLocation("uVSMBleedReduction");
+    uniforms.numSceneLights = program.getUniformLocation("uNumSceneLights");
+    return uniforms;
+  }
+
+  bool initLightCullingProgram() {
+    if (!m_lightCullingProgram.initCompute("light-culling.comp")) {
+      std::cout << "Failed to init light culling program" << std::endl;
+      return false;
+    }
+
+    m_lightCullingUniforms.numLights = m_lightCullingProgram.getUniformLocation("uNumLights");
+    m_lightCullingUniforms.viewMatrix = m_lightCullingProgram.getUniformLocation("uViewMatrix");
+    m_lightCullingUniforms.invViewMatrix =
+      m_lightCullingProgram.getUniformLocation("uInvViewMatrix");
+    m_lightCullingUniforms.projScale = m_lightCullingProgram.getUniformLocation("uProjScale");
+    return true;
+  }
+
+  bool initSkinAlbedoProgram() {
+    if (!m_skinAlbedoProgram.initCompute("skin-albedo.comp")) {
+      std::cout << "Failed to init skin albedo program" << std::endl;
+      return false;
+    }
+
+    m_skinAlbedoUniforms.B = m_skinAlbedoProgram.getUniformLocation("uB");
+    m_skinAlbedoUniforms.S = m_skinAlbedoProgram.getUniformLocation("uS");
+    m_skinAlbedoUniforms.F = m_skinAlbedoProgram.getUniformLocation("uF");
+    m_skinAlbedoUniforms.W = m_skinAlbedoProgram.getUniformLocation("uW");
+    m_skinAlbedoUniforms.M = m_skinAlbedoProgram.getUniformLocation("uM");
+    return true;
+  }
+
+  bool initTSDPrograms() {
+    if (!m_TSDIrradianceProgram.initVertexFragment("texture-space.vert", "g-buffer.frag")) {
+      std::cout << "Failed to init texture-space irradiance program" << std::endl;
+      return false;
+    }
+    m_TSDIrradianceUniforms = getGBufUniforms(m_TSDIrradianceProgram);
+
+    if (!m_TSDBlurProgram.initVertexFragment("quad.vert", "tsd-blur.frag")) {
+      std::cout << "Failed to init texture-space blur program" << std::endl;
       return false;
     }
+    m_TSDBlurUniforms.direction = m_TSDBlurProgram.getUniformLocation("uDirection");
+    m_TSDBlurUniforms.sigma = m_TSDBlurProgram.getUniformLocation("uSigma");
+    m_TSDBlurUniforms.weight = m_TSDBlurProgram.getUniformLocation("uWeight");
+    return true;
+  }
+
+  bool initMainProgram() {
+    for (size_t i = 0; i < NumMainVariants; ++i) {
+      std::vector<std::string> defines;
+      if (i == MainVariantInteriorTiles)
+        defines.emplace_back("SSS_INTERIOR_TILE");
+
+      ShaderProgram& program = m_mainPrograms[i];
+      const char* vertexPath = i == MainVariantFullScreen ? "quad.vert" : "tile.vert";
+      if (!program.initVertexFragment(vertexPath, "main.frag", defines)) {
+        std::cout << "Failed to init main program (variant " << i << ")" << std::endl;
+        return false;
+      }
 
-    m_mainUniforms.light.direction = m_mainProgram.getUniformLocation("uLight.direction");
-    m_mainUniforms.light.color = m_mainProgram.getUniformLocation("uLight.color");
-    m_mainUniforms.light.intensity = m_mainProgram.getUniformLocation("uLight.intensity");
-    m_mainUniforms.light.VPMatrix = m_mainProgram.getUniformLocation("uLight.VPMatrix");
-    m_mainUniforms.enableTransmittance = m_mainProgram.getUniformLocation("uEnableTransmittance");
-    m_mainUniforms.enableBlur = m_mainProgram.getUniformLocation("uEnableBlur");
-    m_mainUniforms.transmittanceStrength =
-      m_mainProgram.getUniformLocation("uTransmittanceStrength");
-    m_mainUniforms.SSSWeight = m_mainProgram.getUniformLocation("uSSSWeight");
-    m_mainUniforms.SSSWidth = m_mainProgram.getUniformLocation("uSSSWidth");
-    m_mainUniforms.SSSNormalBias = m_mainProgram.getUniformLocation("uSSSNormalBias");
+      MainUniforms& uniforms = m_mainUniforms[i];
+      uniforms.light.direction = program.getUniformLocation("uLight.direction");
+      uniforms.light.color = program.getUniformLocation("uLight.color");
+      uniforms.light.intensity = program.getUniformLocation("uLight.intensity");
+      uniforms.light.VPMatrix = program.getUniformLocation("uLight.VPMatrix");
+      uniforms.light.viewMatrix = program.getUniformLocation("uLight.viewMatrix");
+      uniforms.invViewProj = program.getUniformLocation("uInvViewProj");
+      uniforms.cameraPosition = program.getUniformLocation("uCameraPosition");
+      uniforms.enableTransmittance = program.getUniformLocation("uEnableTransmittance");
+      uniforms.enableBlur = program.getUniformLocation("uEnableBlur");
+      uniforms.enableSpecular = program.getUniformLocation("uEnableSpecular");
+      uniforms.transmittanceStrength = program.getUniformLocation("uTransmittanceStrength");
+      uniforms.SSSWeight = program.getUniformLocation("uSSSWeight");
+      uniforms.SSSWidth = program.getUniformLocation("uSSSWidth");
+      uniforms.SSSNormalBias = program.getUniformLocation("uSSSNormalBias");
+      uniforms.blurScale = program.getUniformLocation("uBlurScale");
+      uniforms.textureSpaceDiffusion = program.getUniformLocation("uTextureSpaceDiffusion");
+      uniforms.transmittanceMaxThickness =
+        program.getUniformLocation("uTransmittanceMaxThickness");
+      uniforms.useShadows = program.getUniformLocation("uUseShadows");
+      uniforms.VSMBleedReduction = program.getUniformLocation("uVSMBleedReduction");
+      uniforms.tile = getTileUniforms(program);
+    }
     return true;
   }
 
+  static TileUniforms getTileUniforms(const ShaderProgram& program) {
+    TileUniforms uniforms;
+    uniforms.tileOffset = program.getUniformLocation("uTileOffset");
+    uniforms.viewportSize = program.getUniformLocation("uViewportSize");
+    return uniforms;
+  }
+
   bool initBlurProgram() {
-    if (!m_blurProgram.initVertexFragment("sss-blur.vert", "sss-blur.frag")) {
-      std::cout << "Failed to init blur program" << std::endl;
+    // Other variants are compiled on first use.
+    return blurProgram(0) != nullptr;
+  }
+
+  // Returns nullptr if the variant failed to compile.
+  const BlurProgram* blurProgram(unsigned variant) {
+    auto it = m_blurPrograms.find(variant);
+    if (it != m_blurPrograms.end())
+      return it->second.valid ? &it->second : nullptr;
+
+    std::vector<std::string> defines;
+    if (variant & BlurVariantPerFragmentKernel)
+      defines.emplace_back("SSS_PER_FRAGMENT_KERNEL");
+    if (variant & BlurVariantSeparablePass)
+      defines.emplace_back("SSS_SEPARABLE_PASS");
+    if (variant & BlurVariantBurley)
+      defines.emplace_back("SSS_BURLEY");
+
+    BlurProgram& blur = m_blurPrograms[variant];
+    const char* vertexPath = (variant & BlurVariantTiles) ? "tile.vert" : "sss-blur.vert";
+    const bool initialized =
+      (variant & BlurVariantCompute)
+        ? blur.program.initCompute("sss-blur.comp", defines)
+        : blur.program.initVertexFragment(vertexPath, "sss-blur.frag", defines);
+    if (!initialized) {
+      std::cout << "Failed to init blur program (variant " << variant << ")" << std::endl;
+      return nullptr;
+    }
+
+    const ShaderProgram& program = blur.program;
+    blur.uniforms.fovy = program.getUniformLocation("uFovy");
+    blur.uniforms.sssWidth = program.getUniformLocation("uSSSWidth");
+    blur.uniforms.numSamples = program.getUniformLocation("uNumSamples");
+    blur.uniforms.falloff = program.getUniformLocation("uFalloff");
+    blur.uniforms.strength = program.getUniformLocation("uStrength");
+    blur.uniforms.photonPathLength = program.getUniformLocation("uPhotonPathLength");
+    blur.uniforms.direction = program.getUniformLocation("uDirection");
+    blur.uniforms.resolutionScale = program.getUniformLocation("uResolutionScale");
+    blur.uniforms.tapStride = program.getUniformLocation("uTapStride");
+    blur.uniforms.tapOffset = program.getUniformLocation("uTapOffset");
+    blur.uniforms.rotation = program.getUniformLocation("uRotation");
+    blur.uniforms.tile = getTileUniforms(program);
+    blur.valid = true;
+    return &blur;
+  }
+
+  bool initBlurDownsampleProgram() {
+    if (!m_blurDownsampleProgram.initVertexFragment("quad.vert", "sss-downsample.frag")) {
+      std::cout << "Failed to init blur downsample program" << std::endl;
+      return false;
+    }
+
+    m_blurDownsampleUniforms.scale = m_blurDownsampleProgram.getUniformLocation("uScale");
+    return true;
+  }
+
+  bool initBlurTemporalProgram() {
+    if (!m_blurTemporalProgram.initVertexFragment("quad.vert", "sss-temporal.frag")) {
+      std::cout << "Failed to init blur temporal program" << std::endl;
+      return false;
+    }
+
+    m_blurTemporalUniforms.invViewProj = m_blurTemporalProgram.getUniformLocation("uInvViewProj");
+    m_blurTemporalUniforms.prevViewProj = m_blurTemporalProgram.getUniformLocation("uPrevViewProj");
+    m_blurTemporalUniforms.historyValid = m_blurTemporalProgram.getUniformLocation("uHistoryValid");
+    m_blurTemporalUniforms.maxFrames = m_blurTemporalProgram.getUniformLocation("uMaxFrames");
+    return true;
+  }
+
+  bool initTileClassificationProgram() {
+    if (!m_tileClassificationProgram.initCompute("sss-classify-tiles.comp")) {
+      std::cout << "Failed to init tile classification program" << std::endl;
       return false;
     }
 
-    m_blurUniforms.fovy = m_blurProgram.getUniformLocation("uFovy");
-    m_blurUniforms.sssWidth = m_blurProgram.getUniformLocation("uSSSWidth");
-    m_blurUniforms.numSamples = m_blurProgram.getUniformLocation("uNumSamples");
-    m_blurUniforms.falloff = m_blurProgram.getUniformLocation("uFalloff");
-    m_blurUniforms.strength = m_blurProgram.getUniformLocation("uStrength");
-    m_blurUniforms.photonPathLength = m_blurProgram.getUniformLocation("uPhotonPathLength");
+    m_tileClassificationUniforms.maxTiles =
+      m_tileClassificationProgram.getUniformLocation("uMaxTiles");
     return true;
   }
 
@@ -422,23 +1123,305 @@ private:
     return true;
   }
 
+  void initBlurKernel() {
+    glCreateBuffers(1, &m_blurKernelUBO);
+    glNamedBufferStorage(m_blurKernelUBO, SeparableKernel::MaxNumSamples * sizeof(Vec4f), nullptr,
+                         GL_DYNAMIC_STORAGE_BIT);
+
+    glCreateBuffers(1, &m_burleyKernelUBO);
+    glNamedBufferStorage(m_burleyKernelUBO, BurleyKernel::MaxNumSamples * sizeof(Vec4f), nullptr,
+                         GL_DYNAMIC_STORAGE_BIT);
+  }
+
+  // Only recompute and upload the kernel of the current engine when its parameters changed.
+  void updateBlurKernel() {
+    if (m_diffusionEngine == DiffusionEngine::Burley) {
+      if (m_burleyKernel.update(m_nBurleySamples, m_falloff, m_strength))
+        uploadKernel(m_burleyKernelUBO, m_burleyKernel.samples());
+    } else {
+      if (m_blurKernel.update(m_nSamples, m_falloff, m_strength))
+        uploadKernel(m_blurKernelUBO, m_blurKernel.samples());
+    }
+  }
+
+  static void uploadKernel(GLuint buffer, const std::vector<Vec4f>& samples) {
+    glNamedBufferSubData(buffer, 0, (GLsizeiptr)(samples.size() * sizeof(Vec4f)), samples.data());
+  }
+
 private:
-  bool initMaps() {
-    m_kernelSizeTex = Texture::load("maps/kernelSizeMap.png");
-    m_modelSkinColorlessTex = Texture::load("models/james/textures/james_colorless.png");
-    m_modelSkinParamMap = Texture::load("models/james/textures/james_skin_params.png");
-    m_modelSkinColorLookupTex = Texture::load("maps/skinLookup.png");
-    m_paramTex = Texture::load("tex/combined.png");
+  bool initSkinAlbedoLUT() {
+    if (!m_skinAlbedoLUT.loadCoefficients(SSS_ASSET_DIR "/tex/combined.png"))
+      return false;
+
+    glCreateTextures(GL_TEXTURE_3D, 1, &m_skinAlbedoLUTTex);
+    glTextureStorage3D(m_skinAlbedoLUTTex, 1, GL_RGB16F, SpectralSkinLUT::Size,
+                       SpectralSkinLUT::Size, SpectralSkinLUT::Size);
+    glTextureParameteri(m_skinAlbedoLUTTex, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTextureParameteri(m_skinAlbedoLUTTex, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTextureParameteri(m_skinAlbedoLUTTex, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(m_skinAlbedoLUTTex, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(m_skinAlbedoLUTTex, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
 
-    return m_kernelSizeTex.isValid() && m_modelSkinColorlessTex.isValid() &&
-           m_modelSkinParamMap.isValid() && m_modelSkinColorLookupTex.isValid() &&
-           m_paramTex.isValid();
+    requestSkinAlbedoLUT();
+    return true;
+  }
+
+  // Blood, oxygenation and melanosomes index the LUT, fat and water are baked in it. Built on
+  // m_threadPool from a copy of the coefficients, only the latest request is built to the end and
+  // uploaded.
+  void requestSkinAlbedoLUT() {
+    const unsigned request = ++m_skinAlbedoRequest;
+    m_skinAlbedoRequestedF = m_F;
+    m_skinAlbedoRequestedW = m_W;
+
+    auto lut = std::make_shared<SpectralSkinLUT>(m_skinAlbedoLUT);
+    const float F = m_F;
+    const float W = m_W;
+    m_threadPool.submit([this, request, lut, F, W]() {
+      auto isCancelled = [this, request]() { return request != m_skinAlbedoRequest; };
+      if (isCancelled() || !lut->build(F, W, m_threadPool, true, isCancelled))
+        return;
+
+      m_uploads.push([this, request, lut]() {
+        if (request != m_skinAlbedoRequest)
+          return;
+
+        m_skinAlbedoLUT = std::move(*lut);
+        uploadSkinAlbedoLUT();
+      });
+    });
+  }
+
+  void uploadSkinAlbedoLUT() const {
+    glTextureSubImage3D(m_skinAlbedoLUTTex, 0, 0, 0, 0, SpectralSkinLUT::Size,
+                        SpectralSkinLUT::Size, SpectralSkinLUT::Size, GL_RGB, GL_FLOAT,
+                        m_skinAlbedoLUT.texels().data());
+  }
+
+  // Times the LUT build with and without SIMD, and the spectral loop as it used to run for every
+  // fragment: one work group of skin-albedo.comp per pixel of the viewport.
+  void benchmarkSpectralSkin() {
+    using Ms = std::chrono::duration<float, std::milli>;
+
+    auto start = std::chrono::steady_clock::now();
+    m_skinAlbedoLUT.build(m_F, m_W, m_threadPool, true);
+    m_spectralBenchmark.SIMDMs = Ms(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    m_skinAlbedoLUT.build(m_F, m_W, m_threadPool, false);
+    m_spectralBenchmark.scalarMs = Ms(std::chrono::steady_clock::now() - start).count();
+
+    GLuint target = 0;
+    glCreateTextures(GL_TEXTURE_2D, 1, &target);
+    glTextureStorage2D(target, 1, GL_RGBA16F, 1, 1);
+
+    const ShaderProgram& program = m_skinAlbedoProgram;
+    program.setFloat(m_skinAlbedoUniforms.B, m_B);
+    program.setFloat(m_skinAlbedoUniforms.S, m_S);
+    program.setFloat(m_skinAlbedoUniforms.F, m_F);
+    program.setFloat(m_skinAlbedoUniforms.W, m_W);
+    program.setFloat(m_skinAlbedoUniforms.M, m_M);
+
+    glBindTextureUnit(0, residentTex(m_paramTex));
+    glBindImageTexture(0, target, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+    program.use();
+
+    GLuint query = 0;
+    glCreateQueries(GL_TIME_ELAPSED, 1, &query);
+    glBeginQuery(GL_TIME_ELAPSED, query);
+    glDispatchCompute((GLuint)m_viewportW, (GLuint)m_viewportH, 1);
+    glEndQuery(GL_TIME_ELAPSED);
+
+    GLuint64 ns = 0;
+    glGetQueryObjectui64v(query, GL_QUERY_RESULT, &ns);
+    m_spectralBenchmark.GPUMs = (float)ns * 1e-6f;
+    m_spectralBenchmark.valid = true;
+
+    // The table against the spectral loop at the current parameters, the error of the grid.
+    Vec4f reference;
+    glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+    glGetTextureImage(target, 0, GL_RGBA, GL_FLOAT, sizeof(reference), &reference);
+    const Vec3f error = glm::abs(m_skinAlbedoLUT.sample(m_B, m_S, m_M) - Vec3f(reference));
+    m_spectralBenchmark.LUTError = glm::max(error.x, glm::max(error.y, error.z));
+    uploadSkinAlbedoLUT();
+
+    glDeleteQueries(1, &query);
+    glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+    glBindTextureUnit(0, 0);
+    glDeleteTextures(1, &target);
+
+    std::cout << "Spectral skin: LUT " << m_spectralBenchmark.SIMDMs << " ms (SIMD), "
+              << m_spectralBenchmark.scalarMs << " ms (scalar), GPU per pixel loop "
+              << m_spectralBenchmark.GPUMs << " ms (" << m_viewportW << "x" << m_viewportH
+              << "), LUT error " << m_spectralBenchmark.LUTError << std::endl;
+  }
+
+  void initPreIntegratedLUT() {
+    glCreateTextures(GL_TEXTURE_2D, 1, &m_preIntegratedLUTTex);
+    glTextureStorage2D(m_preIntegratedLUTTex, 1, GL_RGB16F, PreIntegratedLUT::Size,
+                       PreIntegratedLUT::Size);
+    glTextureParameteri(m_preIntegratedLUTTex, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTextureParameteri(m_preIntegratedLUTTex, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTextureParameteri(m_preIntegratedLUTTex, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(m_preIntegratedLUTTex, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    requestPreIntegratedLUT();
+  }
+
+  // The curvature range of the model, the default one until it is loaded.
+  float preIntegratedMaxCurvature() const {
+    if (m_model.maxCurvature() <= 0.0f)
+      return PreIntegratedLUT::DefaultMaxCurvature;
+    return m_model.maxCurvature() / m_curvatureScale;
+  }
+
+  // Integrated on m_threadPool, only the latest request is uploaded. The tables of a dragged
+  // slider are not cached, each step would leave a file behind.
+  void requestPreIntegratedLUT() {
+    const unsigned request = ++m_preIntegratedRequest;
+    m_preIntegratedRequestedFalloff = m_falloff;
+    m_preIntegratedRequestedMaxCurvature = preIntegratedMaxCurvature();
+
+    const Vec3f falloff = m_preIntegratedRequestedFalloff;
+    const float maxCurvature = m_preIntegratedRequestedMaxCurvature;
+    const bool useCache = !ImGui::IsAnyItemActive();
+    const FileCache fileCache = m_fileCache;
+    m_threadPool.submit([this, request, falloff, maxCurvature, useCache, fileCache]() {
+      // Dragging the sliders supersedes the request every frame, stop the stale builds early.
+      auto isCancelled = [this, request]() { return request != m_preIntegratedRequest; };
+      if (isCancelled())
+        return;
+
+      auto lut = std::make_shared<PreIntegratedLUT>();
+      lut->update(falloff, maxCurvature, m_threadPool, useCache ? &fileCache : nullptr,
+                  isCancelled);
+      if (isCancelled())
+        return;
+
+      m_uploads.push([this, request, lut]() {
+        if (request != m_preIntegratedRequest)
+          return;
+
+        m_preIntegratedLUT = std::move(*lut);
+        glTextureSubImage2D(m_preIntegratedLUTTex, 0, 0, 0, PreIntegratedLUT::Size,
+                            PreIntegratedLUT::Size, GL_RGB, GL_FLOAT,
+                            m_preIntegratedLUT.texels().data());
+      });
+    });
+  }
+
+private:
+  // Asset loading: the files are read and decoded by m_threadPool, the GL objects are created by
+  // the uploads queued in m_uploads, see runUploads(). Until then the passes sample
+  // m_placeholderTex and the model is simply not drawn.
+  void runUploads() {
+    m_uploads.run(UploadBudgetMs);
+    pollEnvReadback();
+    if (m_loggedAssetsResident)
+      return;
+
+    const std::chrono::duration<float, std::milli> elapsed =
+      std::chrono::steady_clock::now() - m_initTime;
+    if (m_numPendingLoads == 0) {
+      std::cout << "Assets resident after " << elapsed.count() << " ms" << std::endl;
+      m_loggedAssetsResident = true;
+    }
+  }
+
+  void initPlaceholderTex() {
+    const unsigned char grey[4] = {128, 128, 128, 255};
+    glCreateTextures(GL_TEXTURE_2D, 1, &m_placeholderTex);
+    glTextureStorage2D(m_placeholderTex, 1, GL_RGBA8, 1, 1);
+    glTextureSubImage2D(m_placeholderTex, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+  }
+
+  GLuint residentTex(const Texture& texture) const {
+    return texture.isValid() ? texture.id : m_placeholderTex;
+  }
+
+  // The shadow map and the texture-space atlas are cached, they are redrawn with the new assets.
+  void invalidateCachedPasses() {
+    m_shadowValid = false;
+    m_TSDValid = false;
+  }
+
+  void requestModel() {
+    ++m_numPendingLoads;
+    m_threadPool.submit([this]() {
+      auto data = std::make_shared<MaterialMeshModelData>();
+      const bool read =
+        MaterialMeshModel::read("james", SSS_ASSET_DIR "/models/james/james_hi.obj", *data);
+
+      m_uploads.push([this, data, read]() {
+        --m_numPendingLoads;
+        if (!read)
+          return;
+
+        m_model.upload(*data);
+        // The light frustum is fitted to the bounds.
+        updateLight();
+        invalidateCachedPasses();
+        for (const MaterialMeshModelData::TextureData& texture : data->textures)
+          requestModelTexture(data->baseDir + texture.path, texture.path, texture.usage);
+      });
+    });
+  }
+
+  void requestModelTexture(const Path& fullPath, const std::string& path, TextureUsage usage) {
+    ++m_numPendingLoads;
+    const FileCache fileCache = m_fileCache;
+    m_threadPool.submit([this, fileCache, fullPath, path, usage]() {
+      auto encoded = std::make_shared<EncodedTexture>();
+      const bool loaded = loadEncodedTexture(fullPath, usage, CompressTextures, fileCache,
+                                             *encoded, &m_threadPool);
+
+      m_uploads.push([this, path, encoded, loaded]() {
+        --m_numPendingLoads;
+        if (!loaded)
+          return;
+
+        m_model.attachTexture(path, *encoded);
+        invalidateCachedPasses();
+      });
+    });
+  }
+
+  void requestMaps() {
+    requestTexture(m_kernelSizeTex, "maps/kernelSizeMap.png", TextureUsage::Data);
+    requestTexture(m_modelSkinColorlessTex, "models/james/textures/james_colorless.png",
+                   TextureUsage::Color);
+    requestTexture(m_modelSkinParamMap, "models/james/textures/james_skin_params.png",
+                   TextureUsage::Data);
+    requestTexture(m_modelSkinColorLookupTex, "maps/skinLookup.png", TextureUsage::Data);
+    requestTexture(m_paramTex, "tex/combined.png", TextureUsage::Data);
+  }
+
+  // path is relative to the asset directory, see Texture::load().
+  void requestTexture(Texture& texture, const std::string& path, TextureUsage usage) {
+    ++m_numPendingLoads;
+    Texture* target = &texture;
+    const FileCache fileCache = m_fileCache;
+    m_threadPool.submit([this, target, fileCache, path, usage]() {
+      auto encoded = std::make_shared<EncodedTexture>();
+      const bool loaded = loadEncodedTexture(SSS_ASSET_DIR "/" + path, usage, CompressTextures,
+                                             fileCache, *encoded, &m_threadPool);
+
+      m_uploads.push([this, target, path, encoded, loaded]() {
+        --m_numPendingLoads;
+        if (!loaded)
+          return;
+
+        target->release();
+        *target = Texture::create(*encoded, path);
+        invalidateCachedPasses();
+      });
+    });
   }
 
 private:
   bool updateMainFBs() {
     releaseFBs(false);
-    return initGBufFB() && initMainFB() && initBlurFB();
+    return initGBufFB() && initMainFB() && initBlurFB() && initTileLists();
   }
 
   void initShadowFB() {
@@ -453,60 +1436,235 @@ private:
     glTextureParameteri(m_shadowDepthTex, GL_TEXTURE_SWIZZLE_G, GL_RED);
     glTextureParameteri(m_shadowDepthTex, GL_TEXTURE_SWIZZLE_B, GL_RED);
 
+    // Linear depth and its square, filtered by the lookups. The second texture holds the
+    // horizontal pass of the variance blur.
+    GLuint* momentTextures[] = {&m_shadowLinearDepthTex, &m_shadowBlurTmpTex};
+    for (GLuint* tex : momentTextures) {
+      glCreateTextures(GL_TEXTURE_2D, 1, tex);
+      glTextureStorage2D(*tex, 1, GL_RG32F, ShadowMapSize, ShadowMapSize);
+      glTextureParameteri(*tex, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+      glTextureParameteri(*tex, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+      glTextureParameteri(*tex, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+      glTextureParameteri(*tex, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+
+    glCreateFramebuffers(2, m_shadowBlurFBs);
+    glNamedFramebufferTexture(m_shadowBlurFBs[0], GL_COLOR_ATTACHMENT0, m_shadowBlurTmpTex, 0);
+    glNamedFramebufferTexture(m_shadowBlurFBs[1], GL_COLOR_ATTACHMENT0, m_shadowLinearDepthTex,
+                              0);
+
+    glNamedFramebufferTexture(m_shadowFB, GL_COLOR_ATTACHMENT0, m_shadowLinearDepthTex, 0);
     glNamedFramebufferTexture(m_shadowFB, GL_DEPTH_ATTACHMENT, m_shadowDepthTex, 0);
-    glNamedFramebufferDrawBuffer(m_shadowFB, GL_NONE);
+    glNamedFramebufferDrawBuffer(m_shadowFB, GL_COLOR_ATTACHMENT0);
+
+    m_shadowValid = false;
   }
 
-  void initEnvFB() {
-    glCreateFramebuffers(1, &m_envMapFB);
+  void initTransmittanceLUT() {
+    m_transmittanceLUT.compute();
 
-    glCreateTextures(GL_TEXTURE_CUBE_MAP, 1, &m_envColorCubeMap);
-    glCreateTextures(GL_TEXTURE_CUBE_MAP, 1, &m_envIrradianceCubeMap);
+    glCreateTextures(GL_TEXTURE_1D, 1, &m_transmittanceLUTTex);
+    glTextureStorage1D(m_transmittanceLUTTex, 1, GL_RGB16F, TransmittanceLUT::Size);
+    glTextureParameteri(m_transmittanceLUTTex, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTextureParameteri(m_transmittanceLUTTex, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTextureParameteri(m_transmittanceLUTTex, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureSubImage1D(m_transmittanceLUTTex, 0, 0, TransmittanceLUT::Size, GL_RGB, GL_FLOAT,
+                        m_transmittanceLUT.texels().data());
+  }
+
+  void initSpecularLUT() {
+    glCreateTextures(GL_TEXTURE_2D, 1, &m_specularLUTTex);
+    glTextureStorage2D(m_specularLUTTex, 1, GL_RG16F, SpecularLUT::Size, SpecularLUT::Size);
+    glTextureParameteri(m_specularLUTTex, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTextureParameteri(m_specularLUTTex, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTextureParameteri(m_specularLUTTex, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(m_specularLUTTex, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    updateSpecularLUT();
+  }
+
+  void updateSpecularLUT() {
+    m_specularLUT.compute(m_specularRoughness);
+    glTextureSubImage2D(m_specularLUTTex, 0, 0, 0, SpecularLUT::Size, SpecularLUT::Size, GL_RG,
+                        GL_FLOAT, m_specularLUT.texels().data());
+  }
+
+  void initSceneLights() {
+    glCreateBuffers(1, &m_sceneLightsBuffer);
+    glNamedBufferStorage(m_sceneLightsBuffer, MaxSceneLights * sizeof(SceneLight), nullptr,
+                         GL_DYNAMIC_STORAGE_BIT);
+    m_sceneLightsValid = false;
+  }
+
+  // Light rig spread on a sphere around the model, regenerated when its parameters change.
+  void updateSceneLights() {
+    const AABB bounds = m_model.bounds().transformed(m_model.transform());
+    uint64_t key = fnv1a(m_numSceneLights);
+    key = fnv1a(m_sceneLightIntensity, key);
+    key = fnv1a(bounds, key);
+    if (m_sceneLightsValid && key == m_sceneLightsKey)
+      return;
 
-    glTextureStorage2D(m_envColorCubeMap, 1, GL_RGB16F, EnvColorSize, EnvColorSize);
-    glTextureStorage2D(m_envIrradianceCubeMap, 1, GL_RGB16F, EnvIrradianceSize, EnvIrradianceSize);
+    m_sceneLightsKey = key;
+    m_sceneLightsValid = true;
+
+    const Vec3f center = bounds.isEmpty() ? Vec3fZero : 0.5f * (bounds.min + bounds.max);
+    const float extent = bounds.isEmpty() ? 1.0f : glm::length(bounds.max - bounds.min);
+    const float radius = 0.75f * extent;
+    const float goldenAngle = Pi * (3.0f - glm::sqrt(5.0f));
+
+    std::vector<SceneLight> lights((size_t)m_numSceneLights);
+    for (int i = 0; i < m_numSceneLights; ++i) {
+      // Fibonacci sphere.
+      const float y = 1.0f - 2.0f * ((float)i + 0.5f) / (float)m_numSceneLights;
+      const float r = glm::sqrt(1.0f - y * y);
+      const float phi = goldenAngle * (float)i;
+      const Vec3f dir(r * glm::cos(phi), y, r * glm::sin(phi));
+
+      SceneLightType type = SceneLightType::Point;
+      if (i % 16 == 15)
+        type = SceneLightType::Directional;
+      else if (i % 3 == 2)
+        type = SceneLightType::Spot;
+
+      const Vec3f hue =
+        0.5f + 0.5f * glm::cos(TwoPi * ((float)i / 7.0f + Vec3f(0.0f, 0.33f, 0.67f)));
+
+      SceneLight& light = lights[i];
+      light.positionRange = Vec4f(center + dir * radius, extent);
+      light.directionType = Vec4f(-dir, (float)type);
+      light.color = Vec4f(hue * m_sceneLightIntensity, 0.0f);
+      light.spotCosines = Vec4f(glm::cos(glm::radians(30.0f)), glm::cos(glm::radians(20.0f)),
+                                0.0f, 0.0f);
+    }
+
+    glNamedBufferSubData(m_sceneLightsBuffer, 0, (GLsizeiptr)(lights.size() * sizeof(SceneLight)),
+                         lights.data());
+  }
+
+  void initTSDFBs() {
+    GLuint* textures[] = {&m_TSDIrradianceTex, &m_TSDTmpTex, &m_TSDChainTex, &m_TSDAccumTex};
+    for (GLuint* tex : textures) {
+      glCreateTextures(GL_TEXTURE_2D, 1, tex);
+      glTextureStorage2D(*tex, 1, GL_RGBA16F, TSDAtlasSize, TSDAtlasSize);
+      glTextureParameteri(*tex, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+      glTextureParameteri(*tex, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+      glTextureParameteri(*tex, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+      glTextureParameteri(*tex, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+
+    // Cleared to 1.0, tells the blur which texels are mapped.
+    glCreateTextures(GL_TEXTURE_2D, 1, &m_TSDDepthTex);
+    glTextureStorage2D(m_TSDDepthTex, 1, GL_DEPTH_COMPONENT24, TSDAtlasSize, TSDAtlasSize);
+
+    // g-buffer.frag writes the irradiance to its fourth output.
+    glCreateFramebuffers(1, &m_TSDFB);
+    glNamedFramebufferTexture(m_TSDFB, GL_COLOR_ATTACHMENT0, m_TSDIrradianceTex, 0);
+    glNamedFramebufferTexture(m_TSDFB, GL_DEPTH_ATTACHMENT, m_TSDDepthTex, 0);
+    const GLenum irradianceBuffers[] = {GL_NONE, GL_NONE, GL_NONE, GL_COLOR_ATTACHMENT0};
+    glNamedFramebufferDrawBuffers(m_TSDFB, ARRAY_LENGTH(irradianceBuffers), irradianceBuffers);
+
+    // Horizontal direction.
+    glCreateFramebuffers(2, m_TSDBlurFBs);
+    glNamedFramebufferTexture(m_TSDBlurFBs[0], GL_COLOR_ATTACHMENT0, m_TSDTmpTex, 0);
+    glNamedFramebufferDrawBuffer(m_TSDBlurFBs[0], GL_COLOR_ATTACHMENT0);
+
+    // Vertical direction, also accumulates the weighted gaussians.
+    glNamedFramebufferTexture(m_TSDBlurFBs[1], GL_COLOR_ATTACHMENT0, m_TSDChainTex, 0);
+    glNamedFramebufferTexture(m_TSDBlurFBs[1], GL_COLOR_ATTACHMENT1, m_TSDAccumTex, 0);
+    const GLenum blurBuffers[] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+    glNamedFramebufferDrawBuffers(m_TSDBlurFBs[1], ARRAY_LENGTH(blurBuffers), blurBuffers);
+
+    m_TSDValid = false;
+  }
+
+  // Level 0 of the storage is level m_envBaseLevel of the chain, the finer ones are not allocated.
+  void initEnvCubeMap() {
+    glDeleteTextures(1, &m_envColorCubeMap);
+    glCreateTextures(GL_TEXTURE_CUBE_MAP, 1, &m_envColorCubeMap);
+    // The skybox does not need more precision, 4 bytes per texel instead of 8.
+    const GLsizei size = glm::max(m_envColorSize >> m_envBaseLevel, 1);
+    glTextureStorage2D(m_envColorCubeMap, m_envColorNumLevels - m_envBaseLevel, GL_R11F_G11F_B10F,
+                       size, size);
 
     glTextureParameteri(m_envColorCubeMap, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTextureParameteri(m_envColorCubeMap, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTextureParameteri(m_envColorCubeMap, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-    glTextureParameteri(m_envIrradianceCubeMap, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTextureParameteri(m_envIrradianceCubeMap, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTextureParameteri(m_envIrradianceCubeMap, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
 
-    glTextureParameteri(m_envColorCubeMap, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    // Trilinear, the background is mostly minified.
+    glTextureParameteri(m_envColorCubeMap, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTextureParameteri(m_envColorCubeMap, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTextureParameteri(m_envIrradianceCubeMap, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTextureParameteri(m_envIrradianceCubeMap, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  }
+
+  // Coarsest level still matching the density of the viewport pixels at the center of the
+  // screen: a face spans 2 units of tangent, the viewport height 2 * tan(fovy / 2).
+  GLint envBaseLevelForViewport() const {
+    const float size = (float)m_viewportH / glm::tan(glm::radians(m_cam.fovy()) * 0.5f);
+    GLint level = 0;
+    while (level + 1 < m_envColorNumLevels && (float)(m_envColorSize >> (level + 1)) >= size)
+      ++level;
+    return level;
+  }
+
+  static GLint textureBitsPerTexel(GLuint tex) {
+    const GLenum components[] = {GL_TEXTURE_RED_SIZE,   GL_TEXTURE_GREEN_SIZE,
+                                 GL_TEXTURE_BLUE_SIZE,  GL_TEXTURE_ALPHA_SIZE,
+                                 GL_TEXTURE_DEPTH_SIZE, GL_TEXTURE_STENCIL_SIZE};
+    GLint bits = 0;
+    for (GLenum component : components) {
+      GLint size = 0;
+      glGetTextureLevelParameteriv(tex, 0, component, &size);
+      bits += size;
+    }
+    return bits;
   }
 
   bool initGBufFB() {
     glCreateFramebuffers(1, &m_GBufFB);
 
-    glCreateTextures(GL_TEXTURE_2D, 1, &m_GBufPosTex);
     glCreateTextures(GL_TEXTURE_2D, 1, &m_GBufUVTex);
     glCreateTextures(GL_TEXTURE_2D, 1, &m_GBufNormalTex);
     glCreateTextures(GL_TEXTURE_2D, 1, &m_GBufAlbedoTex);
     glCreateTextures(GL_TEXTURE_2D, 1, &m_GBufIrradianceTex);
     glCreateTextures(GL_TEXTURE_2D, 1, &m_GBufDepthStencilTex);
 
-    glTextureStorage2D(m_GBufPosTex, 1, GL_RGB16F, m_viewportW, m_viewportH);
+    // The position is reconstructed from the depth, see g-buffer.glsl.
     glTextureStorage2D(m_GBufUVTex, 1, GL_RG16F, m_viewportW, m_viewportH);
-    glTextureStorage2D(m_GBufNormalTex, 1, GL_RGB16F, m_viewportW, m_viewportH);
-    glTextureStorage2D(m_GBufAlbedoTex, 1, GL_RGB16F, m_viewportW, m_viewportH);
-    glTextureStorage2D(m_GBufIrradianceTex, 1, GL_RGB16F, m_viewportW, m_viewportH);
+    glTextureStorage2D(m_GBufNormalTex, 1, GL_RG16_SNORM, m_viewportW, m_viewportH);
+    glTextureStorage2D(m_GBufAlbedoTex, 1, GL_SRGB8_ALPHA8, m_viewportW, m_viewportH);
+    // Linear depth in alpha, see g-buffer.frag.
+    glTextureStorage2D(m_GBufIrradianceTex, 1, GL_RGBA16F, m_viewportW, m_viewportH);
     glTextureStorage2D(m_GBufDepthStencilTex, 1, GL_DEPTH24_STENCIL8, m_viewportW, m_viewportH);
 
-    glNamedFramebufferTexture(m_GBufFB, GL_COLOR_ATTACHMENT0, m_GBufPosTex, 0);
-    glNamedFramebufferTexture(m_GBufFB, GL_COLOR_ATTACHMENT1, m_GBufUVTex, 0);
-    glNamedFramebufferTexture(m_GBufFB, GL_COLOR_ATTACHMENT2, m_GBufNormalTex, 0);
-    glNamedFramebufferTexture(m_GBufFB, GL_COLOR_ATTACHMENT3, m_GBufAlbedoTex, 0);
-    glNamedFramebufferTexture(m_GBufFB, GL_COLOR_ATTACHMENT4, m_GBufIrradianceTex, 0);
+    glNamedFramebufferTexture(m_GBufFB, GL_COLOR_ATTACHMENT0, m_GBufUVTex, 0);
+    glNamedFramebufferTexture(m_GBufFB, GL_COLOR_ATTACHMENT1, m_GBufNormalTex, 0);
+    glNamedFramebufferTexture(m_GBufFB, GL_COLOR_ATTACHMENT2, m_GBufAlbedoTex, 0);
+    glNamedFramebufferTexture(m_GBufFB, GL_COLOR_ATTACHMENT3, m_GBufIrradianceTex, 0);
     glNamedFramebufferTexture(m_GBufFB, GL_DEPTH_STENCIL_ATTACHMENT, m_GBufDepthStencilTex, 0);
 
     unsigned int buffers[] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2,
-                              GL_COLOR_ATTACHMENT3, GL_COLOR_ATTACHMENT4};
+                              GL_COLOR_ATTACHMENT3};
     glNamedFramebufferDrawBuffers(m_GBufFB, ARRAY_LENGTH(buffers), buffers);
 
+    m_GBufBitsPerPixel = 0;
+    for (GLuint tex : {m_GBufUVTex, m_GBufNormalTex, m_GBufAlbedoTex, m_GBufIrradianceTex,
+                       m_GBufDepthStencilTex})
+      m_GBufBitsPerPixel += textureBitsPerTexel(tex);
+
+    // Decoded targets, see renderGBufVisualizerUI().
+    glCreateTextures(GL_TEXTURE_2D, 1, &m_GBufVisTex);
+    glTextureStorage2D(m_GBufVisTex, 1, GL_RGBA8, m_viewportW, m_viewportH);
+    glCreateFramebuffers(1, &m_GBufVisFB);
+    glNamedFramebufferTexture(m_GBufVisFB, GL_COLOR_ATTACHMENT0, m_GBufVisTex, 0);
+
+    // Views need a name that was never bound, hence glGenTextures.
+    glGenTextures(1, &m_GBufStencilView);
+    glTextureView(m_GBufStencilView, GL_TEXTURE_2D, m_GBufDepthStencilTex, GL_DEPTH24_STENCIL8, 0,
+                  1, 0, 1);
+    glTextureParameteri(m_GBufStencilView, GL_DEPTH_STENCIL_TEXTURE_MODE, GL_STENCIL_INDEX);
+    glTextureParameteri(m_GBufStencilView, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTextureParameteri(m_GBufStencilView, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
     return glCheckNamedFramebufferStatus(m_GBufFB, GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
   }
 
@@ -525,45 +1683,155 @@ private:
   }
 
   bool initBlurFB() {
+    m_blurFBResolution = m_blurResolution;
+    const GLsizei scale = blurScale();
+    m_blurW = (m_viewportW + scale - 1) / scale;
+    m_blurH = (m_viewportH + scale - 1) / scale;
+
     glCreateFramebuffers(1, &m_blurFB);
+    glCreateFramebuffers(1, &m_blurTmpFB);
 
     glCreateTextures(GL_TEXTURE_2D, 1, &m_blurFBColorTex);
+    glCreateTextures(GL_TEXTURE_2D, 1, &m_blurFBTmpColorTex);
     glCreateTextures(GL_TEXTURE_2D, 1, &m_blurFBStencilTex);
-    glTextureStorage2D(m_blurFBColorTex, 1, GL_RGB16F, m_viewportW, m_viewportH);
-    glTextureStorage2D(m_blurFBStencilTex, 1, GL_STENCIL_INDEX8, m_viewportW, m_viewportH);
+    // RGBA since RGB formats cannot be written by the compute blur.
+    glTextureStorage2D(m_blurFBColorTex, 1, GL_RGBA16F, m_blurW, m_blurH);
+    glTextureStorage2D(m_blurFBTmpColorTex, 1, GL_RGBA16F, m_blurW, m_blurH);
+    glTextureStorage2D(m_blurFBStencilTex, 1, GL_STENCIL_INDEX8, m_blurW, m_blurH);
 
     glNamedFramebufferTexture(m_blurFB, GL_COLOR_ATTACHMENT0, m_blurFBColorTex, 0);
     glNamedFramebufferTexture(m_blurFB, GL_STENCIL_ATTACHMENT, m_blurFBStencilTex, 0);
 
-    return glCheckNamedFramebufferStatus(m_blurFB, GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    // The intermediate target of the two-pass blur shares the stencil mask.
+    glNamedFramebufferTexture(m_blurTmpFB, GL_COLOR_ATTACHMENT0, m_blurFBTmpColorTex, 0);
+    glNamedFramebufferTexture(m_blurTmpFB, GL_STENCIL_ATTACHMENT, m_blurFBStencilTex, 0);
+
+    if (glCheckNamedFramebufferStatus(m_blurFB, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE ||
+        glCheckNamedFramebufferStatus(m_blurTmpFB, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+      return false;
+
+    return initBlurHistoryFBs() && (scale == 1 || initBlurLowResFB());
+  }
+
+  // Ping-pong targets of the temporal accumulation, with the depth of the previous frame for the
+  // disocclusion test.
+  bool initBlurHistoryFBs() {
+    m_blurHistoryValid = false;
+
+    glCreateFramebuffers(2, m_blurHistoryFBs);
+    glCreateTextures(GL_TEXTURE_2D, 2, m_blurHistoryTexs);
+    glCreateTextures(GL_TEXTURE_2D, 1, &m_blurPrevDepthTex);
+    glTextureStorage2D(m_blurPrevDepthTex, 1, GL_DEPTH24_STENCIL8, m_blurW, m_blurH);
+
+    for (int i = 0; i < 2; ++i) {
+      glTextureStorage2D(m_blurHistoryTexs[i], 1, GL_RGBA16F, m_blurW, m_blurH);
+      // The history is reprojected at arbitrary positions.
+      glTextureParameteri(m_blurHistoryTexs[i], GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+      glTextureParameteri(m_blurHistoryTexs[i], GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+      glTextureParameteri(m_blurHistoryTexs[i], GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+      glTextureParameteri(m_blurHistoryTexs[i], GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+      glNamedFramebufferTexture(m_blurHistoryFBs[i], GL_COLOR_ATTACHMENT0, m_blurHistoryTexs[i], 0);
+      if (glCheckNamedFramebufferStatus(m_blurHistoryFBs[i], GL_FRAMEBUFFER) !=
+          GL_FRAMEBUFFER_COMPLETE)
+        return false;
+    }
+    return true;
+  }
+
+  // Downsampled blur inputs, also used to guide the upsample.
+  bool initBlurLowResFB() {
+    glCreateFramebuffers(1, &m_blurLowResFB);
+
+    glCreateTextures(GL_TEXTURE_2D, 1, &m_blurLowResIrradianceTex);
+    glCreateTextures(GL_TEXTURE_2D, 1, &m_blurLowResUVTex);
+    glCreateTextures(GL_TEXTURE_2D, 1, &m_blurLowResNormalTex);
+    glCreateTextures(GL_TEXTURE_2D, 1, &m_blurLowResDepthStencilTex);
+    glTextureStorage2D(m_blurLowResIrradianceTex, 1, GL_RGBA16F, m_blurW, m_blurH);
+    glTextureStorage2D(m_blurLowResUVTex, 1, GL_RG16F, m_blurW, m_blurH);
+    glTextureStorage2D(m_blurLowResNormalTex, 1, GL_RG16_SNORM, m_blurW, m_blurH);
+    glTextureStorage2D(m_blurLowResDepthStencilTex, 1, GL_DEPTH24_STENCIL8, m_blurW, m_blurH);
+
+    glNamedFramebufferTexture(m_blurLowResFB, GL_COLOR_ATTACHMENT0, m_blurLowResIrradianceTex, 0);
+    glNamedFramebufferTexture(m_blurLowResFB, GL_COLOR_ATTACHMENT1, m_blurLowResUVTex, 0);
+    glNamedFramebufferTexture(m_blurLowResFB, GL_COLOR_ATTACHMENT2, m_blurLowResNormalTex, 0);
+    glNamedFramebufferTexture(m_blurLowResFB, GL_DEPTH_STENCIL_ATTACHMENT,
+                              m_blurLowResDepthStencilTex, 0);
+
+    unsigned int buffers[] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2};
+    glNamedFramebufferDrawBuffers(m_blurLowResFB, ARRAY_LENGTH(buffers), buffers);
+
+    return glCheckNamedFramebufferStatus(m_blurLowResFB, GL_FRAMEBUFFER) ==
+           GL_FRAMEBUFFER_COMPLETE;
+  }
+
+  // Scale of the allocated blur targets, m_blurResolution may have changed since.
+  GLsizei blurScale() const {
+    switch (m_blurFBResolution) {
+    case BlurResolution::Half:
+      return 2;
+    case BlurResolution::Quarter:
+      return 4;
+    default:
+      return 1;
+    }
+  }
+
+  // Edge and interior tile lists, each preceded by its indirect draw command.
+  bool initTileLists() {
+    m_numTilesX = (m_viewportW + SSSTileSize - 1) / SSSTileSize;
+    m_numTilesY = (m_viewportH + SSSTileSize - 1) / SSSTileSize;
+    m_maxTiles = m_numTilesX * m_numTilesY;
+
+    const GLsizeiptr size =
+      2 * sizeof(DrawArraysIndirectCommand) + 2 * (GLsizeiptr)m_maxTiles * sizeof(GLuint);
+    glCreateBuffers(1, &m_tileListsBuffer);
+    glNamedBufferStorage(m_tileListsBuffer, size, nullptr, GL_DYNAMIC_STORAGE_BIT);
+    return true;
   }
 
   void releaseFBs(bool releaseFixedSize) {
     if (releaseFixedSize) {
       if (m_shadowFB) {
         glDeleteTextures(1, &m_shadowDepthTex);
+        glDeleteTextures(1, &m_shadowLinearDepthTex);
+        glDeleteTextures(1, &m_shadowBlurTmpTex);
         glDeleteFramebuffers(1, &m_shadowFB);
+        glDeleteFramebuffers(2, m_shadowBlurFBs);
         m_shadowFB = 0;
         m_shadowDepthTex = 0;
+        m_shadowLinearDepthTex = 0;
+        m_shadowBlurTmpTex = 0;
+        m_shadowBlurFBs[0] = m_shadowBlurFBs[1] = 0;
       }
 
-      if (m_envMapFB) {
-        glDeleteFramebuffers(1, &m_envMapFB);
+      if (m_envColorCubeMap) {
         glDeleteTextures(1, &m_envColorCubeMap);
-        glDeleteTextures(1, &m_envIrradianceCubeMap);
-        m_envMapFB = 0;
         m_envColorCubeMap = 0;
-        m_envIrradianceCubeMap = 0;
+        m_envColorSize = 0;
+      }
+
+      if (m_TSDFB) {
+        GLuint textures[] = {m_TSDIrradianceTex, m_TSDDepthTex, m_TSDTmpTex, m_TSDChainTex,
+                             m_TSDAccumTex};
+        glDeleteTextures(ARRAY_LENGTH(textures), textures);
+        glDeleteFramebuffers(1, &m_TSDFB);
+        glDeleteFramebuffers(2, m_TSDBlurFBs);
+        m_TSDFB = 0;
+        m_TSDBlurFBs[0] = m_TSDBlurFBs[1] = 0;
+        m_TSDIrradianceTex = 0;
+        m_TSDDepthTex = 0;
+        m_TSDTmpTex = 0;
+        m_TSDChainTex = 0;
+        m_TSDAccumTex = 0;
       }
     }
 
-    if (m_blurFB) {
-      glDeleteTextures(1, &m_blurFBColorTex);
-      glDeleteTextures(1, &m_blurFBStencilTex);
-      glDeleteFramebuffers(1, &m_blurFB);
-      m_blurFB = 0;
-      m_blurFBColorTex = 0;
-      m_blurFBStencilTex = 0;
+    releaseBlurFB();
+
+    if (m_tileListsBuffer) {
+      glDeleteBuffers(1, &m_tileListsBuffer);
+      m_tileListsBuffer = 0;
     }
 
     if (m_mainFB) {
@@ -576,47 +1844,297 @@ private:
     }
 
     if (m_GBufFB) {
-      glDeleteTextures(1, &m_GBufPosTex);
       glDeleteTextures(1, &m_GBufUVTex);
       glDeleteTextures(1, &m_GBufNormalTex);
+      glDeleteTextures(1, &m_GBufAlbedoTex);
       glDeleteTextures(1, &m_GBufIrradianceTex);
       glDeleteTextures(1, &m_GBufDepthStencilTex);
+      glDeleteTextures(1, &m_GBufStencilView);
+      glDeleteTextures(1, &m_GBufVisTex);
       glDeleteFramebuffers(1, &m_GBufFB);
+      glDeleteFramebuffers(1, &m_GBufVisFB);
       m_GBufFB = 0;
-      m_GBufPosTex = 0;
+      m_GBufVisFB = 0;
       m_GBufUVTex = 0;
       m_GBufNormalTex = 0;
+      m_GBufAlbedoTex = 0;
       m_GBufIrradianceTex = 0;
+      m_GBufVisTex = 0;
       m_GBufDepthStencilTex = 0;
+      m_GBufStencilView = 0;
+    }
+  }
+
+  void releaseBlurFB() {
+    if (m_blurFB) {
+      glDeleteTextures(1, &m_blurFBColorTex);
+      glDeleteTextures(1, &m_blurFBTmpColorTex);
+      glDeleteTextures(1, &m_blurFBStencilTex);
+      glDeleteFramebuffers(1, &m_blurFB);
+      glDeleteFramebuffers(1, &m_blurTmpFB);
+      m_blurFB = 0;
+      m_blurTmpFB = 0;
+      m_blurFBColorTex = 0;
+      m_blurFBTmpColorTex = 0;
+      m_blurFBStencilTex = 0;
+    }
+
+    if (m_blurHistoryFBs[0]) {
+      glDeleteTextures(2, m_blurHistoryTexs);
+      glDeleteTextures(1, &m_blurPrevDepthTex);
+      glDeleteFramebuffers(2, m_blurHistoryFBs);
+      for (int i = 0; i < 2; ++i) {
+        m_blurHistoryFBs[i] = 0;
+        m_blurHistoryTexs[i] = 0;
+      }
+      m_blurPrevDepthTex = 0;
+    }
+
+    if (m_blurLowResFB) {
+      glDeleteTextures(1, &m_blurLowResIrradianceTex);
+      glDeleteTextures(1, &m_blurLowResUVTex);
+      glDeleteTextures(1, &m_blurLowResNormalTex);
+      glDeleteTextures(1, &m_blurLowResDepthStencilTex);
+      glDeleteFramebuffers(1, &m_blurLowResFB);
+      m_blurLowResFB = 0;
+      m_blurLowResIrradianceTex = 0;
+      m_blurLowResUVTex = 0;
+      m_blurLowResNormalTex = 0;
+      m_blurLowResDepthStencilTex = 0;
     }
   }
 
 private:
-  bool renderEnvCubeMaps() {
-    GLuint envColorTex = createEnvTexture(EnvColorMapPath);
-    GLuint envIrradianceTex = createEnvTexture(EnvIrradianceMapPath);
-    if (envColorTex == GL_INVALID_INDEX || envIrradianceTex == GL_INVALID_INDEX) {
-      std::cout << "Failed to load env map" << std::endl;
-      return false;
+  // The cube map and the irradiance only depend on the env map, they are cached together so that
+  // the env map is not even loaded once they have been converted. They are read or computed on a
+  // worker thread. The whole chain is converted and cached, it is read again when the viewport
+  // needs another base level, see envBaseLevelForViewport().
+  void requestEnvCubeMaps() {
+    ++m_numPendingLoads;
+    m_envRequestPending = true;
+
+    const FileCache fileCache = m_fileCache;
+    const auto start = std::chrono::steady_clock::now();
+    m_threadPool.submit([this, fileCache, start]() {
+      const uint64_t key = envCacheKey();
+      auto data = std::make_shared<std::vector<char>>();
+      EnvCacheHeader header;
+      if (fileCache.load("env-cube-map", key, *data) && data->size() >= sizeof(header)) {
+        std::memcpy(&header, data->data(), sizeof(header));
+        const GLsizei numLevels = envNumLevels(header.size);
+        if (header.size > 0 && header.size <= MaxEnvColorSize &&
+            data->size() == sizeof(header) + envCubeMapByteSize(header.size, numLevels)) {
+          m_uploads.push([this, data, header, numLevels, start]() {
+            beginEnvUpload(header.size, numLevels, false);
+
+            m_envIrradianceSH = header.SH;
+            uploadEnvCubeMap(data->data() + sizeof(header));
+            endEnvUpload(true, start);
+          });
+          return;
+        }
+      }
+
+      auto envColor = std::make_shared<HDRImage>();
+      auto SH = std::make_shared<IrradianceSH9>();
+      const bool loaded = envColor->load(envColorMapPath(), 3);
+      // The irradiance is projected from the radiance, no pre-convolved map is needed.
+      if (loaded)
+        SH->project(*envColor, m_threadPool);
+
+      m_uploads.push([this, fileCache, key, data, envColor, SH, loaded, start]() {
+        if (!loaded) {
+          --m_numPendingLoads;
+          m_envRequestPending = false;
+          std::cout << "Failed to load env map" << std::endl;
+          return;
+        }
+        const GLsizei size = envColorSizeForMap(*envColor);
+        const GLsizei numLevels = envNumLevels(size);
+        beginEnvUpload(size, numLevels, true);
+
+        m_envIrradianceSH = *SH;
+        releaseEnvReadback();
+        glCreateQueries(GL_TIME_ELAPSED, 1, &m_envReadback.query);
+        if (!convertEnvCubeMap(*envColor, m_envReadback.query)) {
+          releaseEnvReadback();
+          glDeleteTextures(1, &m_envColorCubeMap);
+          m_envColorCubeMap = 0;
+          m_envColorSize = 0;
+          return;
+        }
+
+        EnvCacheHeader header;
+        header.size = size;
+        header.SH = m_envIrradianceSH;
+        data->resize(sizeof(header) + envCubeMapByteSize(size, numLevels));
+        std::memcpy(data->data(), &header, sizeof(header));
+        beginEnvReadback(key, data);
+        endEnvUpload(false, start);
+      });
+    });
+  }
+
+  // Stored before the levels in the cache.
+  struct EnvCacheHeader {
+    GLsizei size = 0;
+    IrradianceSH9 SH;
+  };
+
+  // A face spans a quarter of the equirectangular map, a larger one would only interpolate it.
+  // Powers of two, the reduction of the levels averages 2x2 texels.
+  static GLsizei envColorSizeForMap(const HDRImage& envColor) {
+    GLsizei size = 1;
+    while (size * 2 <= MaxEnvColorSize && size * 2 <= envColor.width() / 4)
+      size *= 2;
+    return size;
+  }
+
+  static GLsizei envNumLevels(GLsizei size) { return (GLsizei)glm::log2((float)size) + 1; }
+
+  // The conversion writes the whole chain, which is read back for the cache before the storage is
+  // reduced to the levels the viewport needs, see pollEnvReadback().
+  void beginEnvUpload(GLsizei size, GLsizei numLevels, bool convert) {
+    --m_numPendingLoads;
+    m_envRequestPending = false;
+    m_envColorSize = size;
+    m_envColorNumLevels = numLevels;
+    m_envBaseLevel = convert ? 0 : envBaseLevelForViewport();
+    initEnvCubeMap();
+  }
+
+  void endEnvUpload(bool cached, std::chrono::steady_clock::time_point start) {
+    invalidateCachedPasses();
+
+    const std::chrono::duration<float, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+    std::cout << "Env maps (" << m_envColorSize << "x" << m_envColorSize << ") "
+              << (cached ? "loaded from cache" : "converted") << " in " << elapsed.count() << " ms"
+              << std::endl;
+  }
+
+  static const std::string& envColorMapPath() {
+    std::error_code err;
+    return std::filesystem::exists(EnvColorMapPath, err) ? EnvColorMapPath : EnvFallbackMapPath;
+  }
+
+  static uint64_t envCacheKey() {
+    const std::string& path = envColorMapPath();
+    uint64_t key = fnv1a(EnvCacheVersion);
+    key = fnv1a(path.data(), path.size(), key);
+    std::error_code err;
+    key = fnv1a(std::filesystem::file_size(path, err), key);
+    key = fnv1a(std::filesystem::last_write_time(path, err), key);
+    return fnv1a(MaxEnvColorSize, key);
+  }
+
+  static size_t envCubeMapByteSize(GLsizei size, GLsizei numLevels) {
+    size_t byteSize = 0;
+    for (GLsizei level = 0; level < numLevels; ++level)
+      byteSize += envCubeMapLevelByteSize(size, level);
+    return byteSize;
+  }
+
+  // One packed 32-bit value per texel.
+  static size_t envCubeMapLevelByteSize(GLsizei size, GLsizei level) {
+    const size_t levelSize = (size_t)glm::max(size >> level, 1);
+    return 6 * levelSize * levelSize * sizeof(uint32_t);
+  }
+
+  // data holds the whole chain, the levels from m_envBaseLevel are uploaded.
+  void uploadEnvCubeMap(const char* data) const {
+    for (GLsizei level = 0; level < m_envColorNumLevels; ++level) {
+      if (level >= m_envBaseLevel) {
+        const GLsizei size = glm::max(m_envColorSize >> level, 1);
+        glTextureSubImage3D(m_envColorCubeMap, level - m_envBaseLevel, 0, 0, 0, size, size, 6,
+                            GL_RGB, GL_UNSIGNED_INT_10F_11F_11F_REV, data);
+      }
+      data += envCubeMapLevelByteSize(m_envColorSize, level);
     }
+  }
 
-    ShaderProgram envToCubeMapProgram;
-    if (!envToCubeMapProgram.initVertexFragment("env-to-cube-map.vert", "env-to-cube-map.frag")) {
-      std::cout << "Failed to init env to cube map program" << std::endl;
-      return false;
+  // Queues the copy of the levels to a pixel pack buffer after the conversion, data is filled by
+  // pollEnvReadback() once the GPU is done and then stored in the cache. The whole chain is
+  // allocated at that point.
+  void beginEnvReadback(uint64_t key, std::shared_ptr<std::vector<char>> data) {
+    const size_t byteSize = envCubeMapByteSize(m_envColorSize, m_envColorNumLevels);
+    glCreateBuffers(1, &m_envReadback.buffer);
+    glNamedBufferStorage(m_envReadback.buffer, (GLsizeiptr)byteSize, nullptr,
+                         GL_MAP_READ_BIT | GL_CLIENT_STORAGE_BIT);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, m_envReadback.buffer);
+    size_t offset = 0;
+    for (GLsizei level = 0; level < m_envColorNumLevels; ++level) {
+      const size_t levelByteSize = envCubeMapLevelByteSize(m_envColorSize, level);
+      glGetTextureImage(m_envColorCubeMap, level, GL_RGB, GL_UNSIGNED_INT_10F_11F_11F_REV,
+                        (GLsizei)levelByteSize, reinterpret_cast<void*>(offset));
+      offset += levelByteSize;
     }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
 
-    renderEnvCubeMap(envColorTex, envToCubeMapProgram, m_envColorCubeMap, EnvColorSize);
-    renderEnvCubeMap(envIrradianceTex, envToCubeMapProgram, m_envIrradianceCubeMap,
-                     EnvIrradianceSize);
-    return true;
+    m_envReadback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_envReadback.key = key;
+    m_envReadback.data = std::move(data);
+  }
+
+  // GL thread, once per frame. Copies EnvReadbackChunkSize bytes at most, without waiting for the
+  // GPU.
+  void pollEnvReadback() {
+    EnvReadback& readback = m_envReadback;
+    if (!readback.buffer)
+      return;
+
+    const size_t byteSize = readback.data->size() - sizeof(EnvCacheHeader);
+    if (!readback.mapped) {
+      const GLenum status = glClientWaitSync(readback.fence, 0, 0);
+      if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+        return;
+
+      GLuint64 ns = 0;
+      glGetQueryObjectui64v(readback.query, GL_QUERY_RESULT, &ns);
+      std::cout << "Env cube map conversion: " << (float)ns * 1e-6f << " ms GPU" << std::endl;
+
+      readback.mapped = static_cast<const char*>(
+        glMapNamedBufferRange(readback.buffer, 0, (GLsizeiptr)byteSize, GL_MAP_READ_BIT));
+      if (!readback.mapped) {
+        releaseEnvReadback();
+        return;
+      }
+    }
+
+    char* levels = readback.data->data() + sizeof(EnvCacheHeader);
+    const size_t chunkSize = glm::min(EnvReadbackChunkSize, byteSize - readback.numCopied);
+    std::memcpy(levels + readback.numCopied, readback.mapped + readback.numCopied, chunkSize);
+    readback.numCopied += chunkSize;
+    if (readback.numCopied < byteSize)
+      return;
+
+    const FileCache fileCache = m_fileCache;
+    m_threadPool.submit([fileCache, key = readback.key, data = readback.data]() {
+      fileCache.store("env-cube-map", key, data->data(), data->size());
+    });
+
+    // Drops the levels finer than the viewport needs.
+    if (envBaseLevelForViewport() != m_envBaseLevel) {
+      m_envBaseLevel = envBaseLevelForViewport();
+      initEnvCubeMap();
+      uploadEnvCubeMap(levels);
+      invalidateCachedPasses();
+    }
+    releaseEnvReadback();
   }
 
-  static GLuint createEnvTexture(const Path& path) {
-    HDRImage image;
-    if (!image.load(path, 3))
-      return GL_INVALID_INDEX;
+  void releaseEnvReadback() {
+    EnvReadback& readback = m_envReadback;
+    if (readback.mapped)
+      glUnmapNamedBuffer(readback.buffer);
+    glDeleteSync(readback.fence);
+    glDeleteBuffers(1, &readback.buffer);
+    glDeleteQueries(1, &readback.query);
+    readback = EnvReadback();
+  }
 
+  static GLuint createEnvTexture(const HDRImage& image) {
     GLuint tex = 0;
     glCreateTextures(GL_TEXTURE_2D, 1, &tex);
     glTextureStorage2D(tex, 1, GL_RGB16F, image.width(), image.height());
@@ -625,39 +2143,44 @@ private:
     return tex;
   }
 
-  void renderEnvCubeMap(GLuint envTex, const ShaderProgram& envToCubeMapProgram, GLuint outTex,
-                        GLsizei outSize) const {
-    // https://learnopengl.com/PBR/IBL/Diffuse-irradiance
-    Mat4f captureProj = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 10.0f);
-    Mat4f captureViews[] = {
-      // We need one view for each face of the cube map.
-      // clang-format off
-      glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3( 1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-      glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(-1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-      glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3( 0.0f,  1.0f,  0.0f), glm::vec3(0.0f,  0.0f,  1.0f)),
-      glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3( 0.0f, -1.0f,  0.0f), glm::vec3(0.0f,  0.0f, -1.0f)),
-      glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3( 0.0f,  0.0f,  1.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-      glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3( 0.0f,  0.0f, -1.0f), glm::vec3(0.0f, -1.0f,  0.0f))
-      // clang-format on
-    };
-
-    glBindTextureUnit(0, envTex);
-    envToCubeMapProgram.setMat4(envToCubeMapProgram.getUniformLocation("uProj"), captureProj);
-    GLint viewLoc = envToCubeMapProgram.getUniformLocation("uView");
-
-    glViewport(0, 0, outSize, outSize);
-    glBindFramebuffer(GL_FRAMEBUFFER, m_envMapFB);
-    for (int i = 0; i < 6; ++i) {
-      envToCubeMapProgram.setMat4(viewLoc, captureViews[i]);
-
-      glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, outTex, 0, i);
-      glClear(GL_COLOR_BUFFER_BIT);
+  // Writes the six faces of each level with layered image stores, one dispatch per level. The whole
+  // chain must be allocated.
+  bool convertEnvCubeMap(const HDRImage& envColor, GLuint timerQuery) const {
+    ShaderProgram program;
+    if (!program.initCompute("env-to-cube-map.comp")) {
+      std::cout << "Failed to init env to cube map program" << std::endl;
+      return false;
+    }
 
-      m_cube.render(envToCubeMapProgram);
+    GLuint envColorTex = createEnvTexture(envColor);
+    const GLint fromEnvLoc = program.getUniformLocation("uFromEnv");
+
+    glBeginQuery(GL_TIME_ELAPSED, timerQuery);
+
+    glBindTextureUnit(0, envColorTex);
+    program.use();
+    for (GLsizei level = 0; level < m_envColorNumLevels; ++level) {
+      const GLsizei size = glm::max(m_envColorSize >> level, 1);
+      program.setBool(fromEnvLoc, level == 0);
+      if (level > 0)
+        glBindImageTexture(0, m_envColorCubeMap, level - 1, GL_TRUE, 0, GL_READ_ONLY,
+                           GL_R11F_G11F_B10F);
+      glBindImageTexture(1, m_envColorCubeMap, level, GL_TRUE, 0, GL_WRITE_ONLY,
+                         GL_R11F_G11F_B10F);
+
+      const GLuint numGroups = ((GLuint)size + EnvCubeMapGroupSize - 1) / EnvCubeMapGroupSize;
+      glDispatchCompute(numGroups, numGroups, 6);
+      glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
     }
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glEndQuery(GL_TIME_ELAPSED);
+
+    glBindImageTexture(0, 0, 0, GL_TRUE, 0, GL_READ_ONLY, GL_R11F_G11F_B10F);
+    glBindImageTexture(1, 0, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_R11F_G11F_B10F);
     glBindTextureUnit(0, 0);
+    glDeleteTextures(1, &envColorTex);
+    return true;
   }
 
 private:
@@ -684,15 +2207,65 @@ private:
   }
 
 private:
-  void shadowPass() const {
+  // Everything the shadow map depends on. The light matrices are recomputed by the UI every
+  // frame, so they are compared by value.
+  uint64_t shadowKey() const {
+    uint64_t key = fnv1a(m_light.view);
+    key = fnv1a(m_light.proj, key);
+    key = fnv1a(m_light.projFar, key);
+    key = fnv1a(m_shadowMode, key);
+    key = fnv1a(m_shadowBlurRadius, key);
+    return fnv1a(m_model.transform(), key);
+  }
+
+  // Only rendered when the light or the model moved, orbiting the camera reuses the map.
+  void updateLight() {
+    m_light.bounds = m_model.bounds().transformed(m_model.transform());
+    m_light.update();
+  }
+
+  void shadowPass() {
+    const uint64_t key = shadowKey();
+    if (m_shadowValid && key == m_shadowKey)
+      return;
+
+    m_shadowKey = key;
+    m_shadowValid = true;
+
     glViewport(0, 0, ShadowMapSize, ShadowMapSize);
     glBindFramebuffer(GL_FRAMEBUFFER, m_shadowFB);
 
-    Mat4f lightMVP = m_light.proj * m_light.view * m_model.transform();
-    m_shadowProgram.setMat4(m_shadowUniforms.lightMVP, lightMVP);
+    Mat4f lightMV = m_light.view * m_model.transform();
+    m_shadowProgram.setMat4(m_shadowUniforms.lightMVP, m_light.proj * lightMV);
+    m_shadowProgram.setMat4(m_shadowUniforms.lightMV, lightMV);
 
+    // Nothing behind the far plane, the thickness of uncovered texels is large.
+    const GLfloat clearDepth[4] = {m_light.projFar, m_light.projFar * m_light.projFar};
+    glClearNamedFramebufferfv(m_shadowFB, GL_COLOR, 0, clearDepth);
     glClear(GL_DEPTH_BUFFER_BIT);
     m_model.render(m_shadowProgram);
+
+    if (m_shadowMode == ShadowMode::Variance)
+      blurShadowMoments();
+  }
+
+  // Separable gaussian over the moments, both passes only read one texture.
+  void blurShadowMoments() const {
+    glDisable(GL_DEPTH_TEST);
+    m_shadowBlurProgram.setInt(m_shadowBlurUniforms.radius, m_shadowBlurRadius);
+
+    const GLuint inputs[] = {m_shadowLinearDepthTex, m_shadowBlurTmpTex};
+    const Vec2f steps[] = {Vec2f(1.0f / (float)ShadowMapSize, 0.0f),
+                           Vec2f(0.0f, 1.0f / (float)ShadowMapSize)};
+    for (int pass = 0; pass < 2; ++pass) {
+      glBindFramebuffer(GL_FRAMEBUFFER, m_shadowBlurFBs[pass]);
+      glBindTextureUnit(0, inputs[pass]);
+      m_shadowBlurProgram.setVec2(m_shadowBlurUniforms.step, steps[pass]);
+      m_quad.render(m_shadowBlurProgram);
+    }
+
+    glBindTextureUnit(0, 0);
+    glEnable(GL_DEPTH_TEST);
   }
 
   void GBufPass() const {
@@ -700,58 +2273,160 @@ private:
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
     glBindFramebuffer(GL_FRAMEBUFFER, m_GBufFB);
 
-    Mat4f model = m_model.transform();
-    Mat4f mvp = m_cam.projectionMatrix() * m_cam.viewMatrix() * model;
-    m_GBufProgram.setMat4(m_GBufUniforms.modelMatrix, model);
-    m_GBufProgram.setMat4(m_GBufUniforms.MVPMatrix, mvp);
-    m_GBufProgram.setMat4(m_GBufUniforms.normalMatrix, glm::transpose(glm::inverse(model)));
-
-    m_GBufProgram.setVec3(m_GBufUniforms.light.position, m_light.position);
-    m_GBufProgram.setVec3(m_GBufUniforms.light.direction, m_light.direction);
-    m_GBufProgram.setVec3(m_GBufUniforms.light.color, m_light.color);
-    m_GBufProgram.setFloat(m_GBufUniforms.light.intensity, m_light.intensity);
-
-    m_GBufProgram.setBool(m_GBufUniforms.gammaCorrect, m_gammaCorrect);
-    m_GBufProgram.setBool(m_GBufUniforms.useDynamicSkinColor, m_useDynamicSkinColor);
-    m_GBufProgram.setBool(m_GBufUniforms.useEnvIrradiance, m_useEnvIrradiance);
-
-    m_GBufProgram.setFloat(m_GBufUniforms.B, m_B);
-    m_GBufProgram.setFloat(m_GBufUniforms.S, m_S);
-    m_GBufProgram.setFloat(m_GBufUniforms.F, m_F);
-    m_GBufProgram.setFloat(m_GBufUniforms.W, m_W);
-    m_GBufProgram.setFloat(m_GBufUniforms.M, m_M);
+    setGBufUniforms(m_GBufProgram, m_GBufUniforms,
+                    m_cam.projectionMatrix() * m_cam.viewMatrix() * m_model.transform());
 
     glEnable(GL_STENCIL_TEST);
     glStencilMask(0xFF);
     glClearStencil(0);
 
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+    glClearNamedFramebufferfv(m_GBufFB, GL_COLOR, 3, BlurBackground);
 
     glStencilFunc(GL_ALWAYS, 1, 0xFF);
     glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
 
-    glBindTextureUnit(0, m_envIrradianceCubeMap);
-    if (m_useDynamicSkinColor)
-      glBindTextureUnit(1, m_modelSkinColorlessTex.id);
-    else
+    // Encodes the linear albedo into its sRGB target.
+    glEnable(GL_FRAMEBUFFER_SRGB);
+    bindGBufInputs();
+    m_model.renderForGBuf(m_GBufProgram);
+    unbindGBufInputs();
+    glDisable(GL_FRAMEBUFFER_SRGB);
+
+    glStencilMask(0x00);
+    glDisable(GL_STENCIL_TEST);
+  }
+
+  void setGBufUniforms(const ShaderProgram& program, const GBufUniforms& uniforms,
+                       const Mat4f& mvp) const {
+    Mat4f model = m_model.transform();
+    program.setMat4(uniforms.modelMatrix, model);
+    program.setMat4(uniforms.MVPMatrix, mvp);
+    program.setMat4(uniforms.normalMatrix, glm::transpose(glm::inverse(model)));
+    program.setMat4(uniforms.viewMatrix, m_cam.viewMatrix());
+
+    program.setVec3(uniforms.light.direction, m_light.direction);
+    program.setVec3(uniforms.light.color, m_light.color);
+    program.setFloat(uniforms.light.intensity, m_light.intensity);
+    program.setMat4(uniforms.light.VPMatrix, m_light.proj * m_light.view);
+    program.setMat4(uniforms.light.viewMatrix, m_light.view);
+    program.setBool(uniforms.useShadows, m_shadowMode == ShadowMode::Variance);
+    program.setFloat(uniforms.VSMBleedReduction, m_VSMBleedReduction);
+
+    program.setBool(uniforms.gammaCorrect, m_gammaCorrect);
+    program.setBool(uniforms.useDynamicSkinColor, m_useDynamicSkinColor);
+    program.setVec3(uniforms.skinAlbedoLUTCoord, SpectralSkinLUT::textureCoord(m_B, m_S, m_M));
+    program.setBool(uniforms.useEnvIrradiance, m_useEnvIrradiance);
+    program.setVec3Array(uniforms.envIrradianceSH, m_envIrradianceSH.coefficients,
+                         IrradianceSH9::NumCoefficients);
+    program.setBool(uniforms.usePreIntegratedSkin,
+                    m_skinDiffusionMode == SkinDiffusionMode::PreIntegrated);
+    program.setFloat(uniforms.preIntegratedMaxCurvature, m_preIntegratedLUT.maxCurvature());
+    program.setFloat(uniforms.curvatureScale, m_curvatureScale);
+    program.setFloat(uniforms.specularIntensity, m_specularIntensity);
+  }
+
+  void bindGBufInputs() const {
+    glBindTextureUnit(0, m_shadowLinearDepthTex);
+    if (m_useDynamicSkinColor) {
+      glBindTextureUnit(1, residentTex(m_modelSkinColorlessTex));
+    } else {
+      // Replaced by the albedo of the mesh once it is resident.
+      glBindTextureUnit(1, m_placeholderTex);
       m_model.bindMeshAlbedo(0, 1);
+    }
 
     // Normal map is bound by the mesh.
 
-    glBindTextureUnit(3, m_modelSkinParamMap.id);
-    glBindTextureUnit(4, m_modelSkinColorLookupTex.id);
-    glBindTextureUnit(5, m_paramTex.id);
-
-    m_model.renderForGBuf(m_GBufProgram);
+    glBindTextureUnit(3, residentTex(m_modelSkinParamMap));
+    glBindTextureUnit(4, residentTex(m_modelSkinColorLookupTex));
+    glBindTextureUnit(5, m_skinAlbedoLUTTex);
+    glBindTextureUnit(6, m_preIntegratedLUTTex);
+  }
 
+  void unbindGBufInputs() const {
     glBindTextureUnit(0, 0);
     glBindTextureUnit(1, 0);
 
     glBindTextureUnit(3, 0);
     glBindTextureUnit(4, 0);
+    glBindTextureUnit(5, 0);
+    glBindTextureUnit(6, 0);
+  }
 
-    glStencilMask(0x00);
-    glDisable(GL_STENCIL_TEST);
+  // Everything the irradiance rasterized in the atlas depends on.
+  uint64_t TSDKey() const {
+    uint64_t key = fnv1a(m_light.direction);
+    key = fnv1a(m_light.color, key);
+    key = fnv1a(m_light.intensity, key);
+    key = fnv1a(m_useEnvIrradiance, key);
+    key = fnv1a(m_gammaCorrect, key);
+    key = fnv1a(m_useDynamicSkinColor, key);
+    key = fnv1a(shadowKey(), key);
+    key = fnv1a(m_VSMBleedReduction, key);
+    // Covers the count, the intensity and the bounds, updated before the passes.
+    key = fnv1a(m_numSceneLights > 0 ? m_sceneLightsKey : 0, key);
+    const float skinParams[] = {m_B, m_S, m_F, m_W, m_M};
+    key = fnv1a(skinParams, key);
+    return fnv1a(m_model.transform(), key);
+  }
+
+  // Texture-space diffusion: the irradiance is rasterized in the UV atlas and blurred by a chain
+  // of gaussians, each one blurring the previous result by the difference of their variances.
+  // The atlas does not depend on the camera and is only updated when the lighting changes.
+  void textureSpaceDiffusionPass() {
+    const uint64_t key = TSDKey();
+    if (m_TSDValid && key == m_TSDKey)
+      return;
+
+    m_TSDKey = key;
+    m_TSDValid = true;
+
+    glViewport(0, 0, TSDAtlasSize, TSDAtlasSize);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_TSDFB);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // The MVP matrix is not used by texture-space.vert.
+    setGBufUniforms(m_TSDIrradianceProgram, m_TSDIrradianceUniforms, Mat4fId);
+    // Not culled, the atlas is only rasterized when the lighting changes.
+    m_TSDIrradianceProgram.setInt(m_TSDIrradianceUniforms.numSceneLights, m_numSceneLights);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SceneLightsBinding, m_sceneLightsBuffer);
+    bindGBufInputs();
+    m_model.renderForGBuf(m_TSDIrradianceProgram);
+    unbindGBufInputs();
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SceneLightsBinding, 0);
+
+    const GLfloat zero[4] = {};
+    glClearNamedFramebufferfv(m_TSDBlurFBs[1], GL_COLOR, 1, zero);
+
+    glEnablei(GL_BLEND, 1);
+    glBlendFunci(1, GL_ONE, GL_ONE);
+    glBindTextureUnit(1, m_TSDDepthTex);
+
+    float variance = 0.0f;
+    GLuint input = m_TSDIrradianceTex;
+    for (const TSDGaussian& gaussian : TSDGaussians) {
+      const float sigma = std::sqrt(gaussian.variance - variance) / TSDTexelSizeMM;
+      variance = gaussian.variance;
+      m_TSDBlurProgram.setFloat(m_TSDBlurUniforms.sigma, sigma);
+      m_TSDBlurProgram.setVec3(m_TSDBlurUniforms.weight, gaussian.weight);
+
+      glBindFramebuffer(GL_FRAMEBUFFER, m_TSDBlurFBs[0]);
+      m_TSDBlurProgram.setVec2(m_TSDBlurUniforms.direction, Vec2f(1.0f, 0.0f));
+      glBindTextureUnit(0, input);
+      m_quad.render(m_TSDBlurProgram);
+
+      glBindFramebuffer(GL_FRAMEBUFFER, m_TSDBlurFBs[1]);
+      m_TSDBlurProgram.setVec2(m_TSDBlurUniforms.direction, Vec2f(0.0f, 1.0f));
+      glBindTextureUnit(0, m_TSDTmpTex);
+      m_quad.render(m_TSDBlurProgram);
+
+      input = m_TSDChainTex;
+    }
+
+    glBindTextureUnit(0, 0);
+    glBindTextureUnit(1, 0);
+    glDisablei(GL_BLEND, 1);
   }
 
   void mainPass() const {
@@ -761,28 +2436,51 @@ private:
     glViewport(0, 0, m_viewportW, m_viewportH);
     glBindFramebuffer(GL_FRAMEBUFFER, m_mainFB);
 
-    glBindTextureUnit(0, m_shadowDepthTex);
+    glBindTextureUnit(0, m_shadowLinearDepthTex);
 
-    glBindTextureUnit(1, m_GBufPosTex);
+    glBindTextureUnit(1, m_GBufDepthStencilTex);
     glBindTextureUnit(2, m_GBufUVTex);
     glBindTextureUnit(3, m_GBufNormalTex);
     glBindTextureUnit(4, m_GBufAlbedoTex);
     glBindTextureUnit(5, m_GBufIrradianceTex);
 
-    glBindTextureUnit(6, m_blurFBColorTex);
-
-    m_mainProgram.setVec3(m_mainUniforms.light.direction, m_light.direction);
-    m_mainProgram.setVec3(m_mainUniforms.light.color, m_light.color);
-    m_mainProgram.setFloat(m_mainUniforms.light.intensity, m_light.intensity);
-    m_mainProgram.setMat4(m_mainUniforms.light.VPMatrix, m_light.proj * m_light.view);
-
-    m_mainProgram.setBool(m_mainUniforms.enableTransmittance, m_enableTransmittance);
-    m_mainProgram.setBool(m_mainUniforms.enableBlur, m_enableBlur);
-
-    m_mainProgram.setFloat(m_mainUniforms.transmittanceStrength, m_transmittanceStrength);
-    m_mainProgram.setFloat(m_mainUniforms.SSSWeight, m_SSSWeight);
-    m_mainProgram.setFloat(m_mainUniforms.SSSWidth, m_SSSWidth);
-    m_mainProgram.setFloat(m_mainUniforms.SSSNormalBias, m_SSSNormalBias);
+    const bool textureSpace = m_skinDiffusionMode == SkinDiffusionMode::TextureSpace;
+    glBindTextureUnit(6, textureSpace ? m_TSDAccumTex : blurResultTex());
+    glBindTextureUnit(7, m_specularLUTTex);
+    const bool upsampleBlur = !textureSpace && m_blurLowResFB != 0;
+    if (upsampleBlur) {
+      glBindTextureUnit(8, m_blurLowResDepthStencilTex);
+      glBindTextureUnit(9, m_blurLowResNormalTex);
+    }
+    glBindTextureUnit(10, m_transmittanceLUTTex);
+
+    const int scale = upsampleBlur ? blurScale() : 1;
+    const Mat4f invViewProj = glm::inverse(m_cam.projectionMatrix() * m_cam.viewMatrix());
+    for (size_t i = 0; i < NumMainVariants; ++i) {
+      const ShaderProgram& program = m_mainPrograms[i];
+      const MainUniforms& uniforms = m_mainUniforms[i];
+      program.setVec3(uniforms.light.direction, m_light.direction);
+      program.setVec3(uniforms.light.color, m_light.color);
+      program.setFloat(uniforms.light.intensity, m_light.intensity);
+      program.setMat4(uniforms.light.VPMatrix, m_light.proj * m_light.view);
+      program.setMat4(uniforms.light.viewMatrix, m_light.view);
+      program.setMat4(uniforms.invViewProj, invViewProj);
+      program.setVec3(uniforms.cameraPosition, m_cam.position());
+
+      program.setBool(uniforms.enableTransmittance, m_enableTransmittance);
+      program.setBool(uniforms.enableBlur, textureSpace ? m_enableBlur : blurEnabled());
+      program.setBool(uniforms.enableSpecular, m_enableSpecular);
+      program.setBool(uniforms.textureSpaceDiffusion, textureSpace);
+
+      program.setFloat(uniforms.transmittanceStrength, m_transmittanceStrength);
+      program.setFloat(uniforms.SSSWeight, m_SSSWeight);
+      program.setFloat(uniforms.SSSWidth, m_SSSWidth);
+      program.setFloat(uniforms.SSSNormalBias, m_SSSNormalBias);
+      program.setInt(uniforms.blurScale, scale);
+      program.setFloat(uniforms.transmittanceMaxThickness, TransmittanceLUT::MaxThickness);
+      program.setBool(uniforms.useShadows, m_shadowMode == ShadowMode::Variance);
+      program.setFloat(uniforms.VSMBleedReduction, m_VSMBleedReduction);
+    }
 
     glEnable(GL_STENCIL_TEST);
     glStencilMask(0x00);
@@ -791,7 +2489,13 @@ private:
 
     glClear(GL_COLOR_BUFFER_BIT);
 
-    m_quad.render(m_mainProgram);
+    if (m_useTiles) {
+      drawTiles(m_mainPrograms[MainVariantEdgeTiles], m_mainUniforms[MainVariantEdgeTiles].tile,
+                m_mainPrograms[MainVariantInteriorTiles],
+                m_mainUniforms[MainVariantInteriorTiles].tile);
+    } else {
+      m_quad.render(m_mainPrograms[MainVariantFullScreen]);
+    }
 
     glDisable(GL_STENCIL_TEST);
 
@@ -804,6 +2508,12 @@ private:
     glBindTextureUnit(5, 0);
 
     glBindTextureUnit(6, 0);
+    glBindTextureUnit(7, 0);
+    if (upsampleBlur) {
+      glBindTextureUnit(8, 0);
+      glBindTextureUnit(9, 0);
+    }
+    glBindTextureUnit(10, 0);
 
     if (m_showSkyBox) {
       m_skyBoxProgram.setMat4(m_skyBoxUniforms.proj, m_cam.projectionMatrix());
@@ -815,34 +2525,174 @@ private:
     }
   }
 
-  void blurPass() const {
-    glBlitNamedFramebuffer(m_GBufFB, m_blurFB, 0, 0, m_viewportW, m_viewportH, 0, 0, m_viewportW,
-                           m_viewportH, GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT, GL_NEAREST);
+  void blurPass() {
+    updateBlurTapSubset();
+    if (m_blurLowResFB)
+      downsampleBlurInputs();
 
-    glViewport(0, 0, m_viewportW, m_viewportH);
-    glBindFramebuffer(GL_FRAMEBUFFER, m_blurFB);
+    const bool burley = m_diffusionEngine == DiffusionEngine::Burley;
+    if (m_blurBackend == BlurBackend::Compute && !burley) {
+      computeBlurPass();
+      return;
+    }
 
-    glBindTextureUnit(0, m_GBufIrradianceTex);
-    glBindTextureUnit(1, m_GBufDepthStencilTex);
-    glBindTextureUnit(2, m_kernelSizeTex.id);
-    glBindTextureUnit(3, m_GBufUVTex);
+    // Also fills the stencil of the intermediate framebuffer, they share the attachment.
+    const GLuint inputFB = m_blurLowResFB ? m_blurLowResFB : m_GBufFB;
+    glBlitNamedFramebuffer(inputFB, m_blurFB, 0, 0, m_blurW, m_blurH, 0, 0, m_blurW, m_blurH,
+                           GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT, GL_NEAREST);
+
+    glViewport(0, 0, m_blurW, m_blurH);
 
-    m_blurProgram.setFloat(m_blurUniforms.fovy, m_cam.fovy());
-    m_blurProgram.setFloat(m_blurUniforms.sssWidth, m_SSSWidth);
-    m_blurProgram.setInt(m_blurUniforms.numSamples, m_nSamples);
-    m_blurProgram.setVec3(m_blurUniforms.falloff, m_falloff);
-    m_blurProgram.setVec3(m_blurUniforms.strength, m_strength);
-    m_blurProgram.setFloat(m_blurUniforms.photonPathLength, m_photonPathLength);
+    glBindTextureUnit(2, residentTex(m_kernelSizeTex));
+    glBindTextureUnit(3, blurInputUVTex());
+    glBindBufferBase(GL_UNIFORM_BUFFER, BlurKernelBinding,
+                     burley ? m_burleyKernelUBO : m_blurKernelUBO);
 
     glEnable(GL_STENCIL_TEST);
     glStencilMask(0x00);
     glStencilFunc(GL_EQUAL, 1, 0xFF);
     glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
 
-    glClear(GL_COLOR_BUFFER_BIT);
+    unsigned variant = m_usePerFragmentKernel ? (unsigned)BlurVariantPerFragmentKernel : 0u;
+    if (m_useTiles)
+      variant |= BlurVariantTiles;
+    if (burley) {
+      // Radial, so not separable.
+      if (const BlurProgram* blur = blurProgram((variant & BlurVariantTiles) | BlurVariantBurley))
+        drawBlur(*blur, m_blurFB, blurInputIrradianceTex(), Vec2fZero);
+    } else if (m_blurMode == BlurMode::TwoPass) {
+      if (const BlurProgram* blur = blurProgram(variant | BlurVariantSeparablePass)) {
+        drawBlur(*blur, m_blurTmpFB, blurInputIrradianceTex(), Vec2f(1.0f, 0.0f));
+        drawBlur(*blur, m_blurFB, m_blurFBTmpColorTex, Vec2f(0.0f, 1.0f));
+      }
+    } else {
+      if (const BlurProgram* blur = blurProgram(variant))
+        drawBlur(*blur, m_blurFB, blurInputIrradianceTex(), Vec2fZero);
+    }
+
+    glDisable(GL_STENCIL_TEST);
+
+    glBindTextureUnit(0, 0);
+    glBindTextureUnit(2, 0);
+    glBindTextureUnit(3, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, BlurKernelBinding, 0);
+  }
+
+  // Without temporal accumulation all the taps are blurred every frame.
+  void updateBlurTapSubset() {
+    if (!m_useTemporalBlur) {
+      m_blurTapStride = 1;
+      return;
+    }
+
+    // The center sample is always blurred.
+    const int nTaps = blurNumSamples() - 1;
+    m_blurTapStride = glm::max(1, (nTaps + m_temporalTapsPerFrame - 1) / m_temporalTapsPerFrame);
+    ++m_blurFrame;
+  }
+
+  // Tap subset of the blur in the given direction. The vertical pass of the two-pass blur cycles
+  // through its subsets more slowly than the horizontal one, so that every combination of the two
+  // is eventually accumulated.
+  int blurTapOffset(const Vec2f& direction) const {
+    const unsigned stride = (unsigned)m_blurTapStride;
+    return (int)((direction.y != 0.0f ? m_blurFrame / stride : m_blurFrame) % stride);
+  }
+
+  // Everything the blurred irradiance depends on, except the camera which is reprojected.
+  uint64_t blurHistoryKey() const {
+    uint64_t key = fnv1a(m_diffusionEngine);
+    key = fnv1a(blurNumSamples(), key);
+    key = fnv1a(m_falloff, key);
+    key = fnv1a(m_strength, key);
+    key = fnv1a(m_SSSWidth, key);
+    key = fnv1a(m_photonPathLength, key);
+    key = fnv1a(m_blurMode, key);
+    key = fnv1a(m_blurBackend, key);
+    key = fnv1a(m_usePerFragmentKernel, key);
+    key = fnv1a(m_light.direction, key);
+    key = fnv1a(m_light.color, key);
+    key = fnv1a(m_light.intensity, key);
+    key = fnv1a(m_numSceneLights, key);
+    key = fnv1a(m_sceneLightIntensity, key);
+    key = fnv1a(m_useEnvIrradiance, key);
+    key = fnv1a(m_useDynamicSkinColor, key);
+    const float skinParams[] = {m_B, m_S, m_F, m_W, m_M};
+    key = fnv1a(skinParams, key);
+    return fnv1a(m_model.transform(), key);
+  }
+
+  // Accumulates the blurred irradiance into the history, see sss-temporal.frag.
+  void blurTemporalPass() {
+    const uint64_t key = blurHistoryKey();
+    if (key != m_blurHistoryKey)
+      m_blurHistoryValid = false;
+    m_blurHistoryKey = key;
+
+    const int write = 1 - m_blurHistoryIndex;
+    const Mat4f viewProj = m_cam.projectionMatrix() * m_cam.viewMatrix();
+
+    glViewport(0, 0, m_blurW, m_blurH);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_blurHistoryFBs[write]);
+    glDisable(GL_DEPTH_TEST);
+
+    glBindTextureUnit(0, m_blurFBColorTex);
+    glBindTextureUnit(1, m_blurHistoryTexs[m_blurHistoryIndex]);
+    glBindTextureUnit(2, blurInputDepthTex());
+    glBindTextureUnit(3, m_blurPrevDepthTex);
+
+    const ShaderProgram& program = m_blurTemporalProgram;
+    const BlurTemporalUniforms& uniforms = m_blurTemporalUniforms;
+    program.setMat4(uniforms.invViewProj, glm::inverse(viewProj));
+    program.setMat4(uniforms.prevViewProj, m_blurPrevViewProj);
+    program.setBool(uniforms.historyValid, m_blurHistoryValid);
+    program.setFloat(uniforms.maxFrames, (float)m_temporalMaxFrames);
+    m_quad.render(program);
+
+    glEnable(GL_DEPTH_TEST);
+    glBindTextureUnit(0, 0);
+    glBindTextureUnit(1, 0);
+    glBindTextureUnit(2, 0);
+    glBindTextureUnit(3, 0);
+
+    glCopyImageSubData(blurInputDepthTex(), GL_TEXTURE_2D, 0, 0, 0, 0, m_blurPrevDepthTex,
+                       GL_TEXTURE_2D, 0, 0, 0, 0, m_blurW, m_blurH, 1);
+    m_blurPrevViewProj = viewProj;
+    m_blurHistoryIndex = write;
+    m_blurHistoryValid = true;
+  }
+
+  GLuint blurResultTex() const {
+    return m_useTemporalBlur ? m_blurHistoryTexs[m_blurHistoryIndex] : m_blurFBColorTex;
+  }
+
+  // Writes the depth and stencil of the low resolution inputs from the closest sample of each
+  // footprint, see sss-downsample.frag.
+  void downsampleBlurInputs() const {
+    glViewport(0, 0, m_blurW, m_blurH);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_blurLowResFB);
+
+    glBindTextureUnit(0, m_GBufIrradianceTex);
+    glBindTextureUnit(1, m_GBufDepthStencilTex);
+    glBindTextureUnit(2, m_GBufUVTex);
+    glBindTextureUnit(3, m_GBufNormalTex);
 
-    m_quad.render(m_blurProgram);
+    m_blurDownsampleProgram.setInt(m_blurDownsampleUniforms.scale, blurScale());
 
+    glEnable(GL_STENCIL_TEST);
+    glStencilMask(0xFF);
+    glClearStencil(0);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+    glClearNamedFramebufferfv(m_blurLowResFB, GL_COLOR, 0, BlurBackground);
+
+    glStencilFunc(GL_ALWAYS, 1, 0xFF);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+    glDepthFunc(GL_ALWAYS);
+
+    m_quad.render(m_blurDownsampleProgram);
+
+    glDepthFunc(GL_LESS);
+    glStencilMask(0x00);
     glDisable(GL_STENCIL_TEST);
 
     glBindTextureUnit(0, 0);
@@ -851,6 +2701,189 @@ private:
     glBindTextureUnit(3, 0);
   }
 
+  GLuint blurInputIrradianceTex() const {
+    return m_blurLowResFB ? m_blurLowResIrradianceTex : m_GBufIrradianceTex;
+  }
+
+  GLuint blurInputDepthTex() const {
+    return m_blurLowResFB ? m_blurLowResDepthStencilTex : m_GBufDepthStencilTex;
+  }
+
+  GLuint blurInputUVTex() const { return m_blurLowResFB ? m_blurLowResUVTex : m_GBufUVTex; }
+
+  void drawBlur(const BlurProgram& blur, GLuint fb, GLuint colorTex, const Vec2f& direction) const {
+    glBindFramebuffer(GL_FRAMEBUFFER, fb);
+    glBindTextureUnit(0, colorTex);
+    setBlurUniforms(blur, direction);
+
+    // The second pass of a two-pass blur reads the depth of the first one.
+    glClearNamedFramebufferfv(fb, GL_COLOR, 0, BlurBackground);
+    if (m_useTiles)
+      drawTiles(blur.program, blur.uniforms.tile, blur.program, blur.uniforms.tile);
+    else
+      m_quad.render(blur.program);
+  }
+
+  // Same inputs as the fragment blur, but the stencil mask is replaced by a depth test in the
+  // shader.
+  void computeBlurPass() {
+    const BlurProgram* blur = blurProgram(BlurVariantCompute);
+    if (!blur)
+      return;
+
+    glBindTextureUnit(3, blurInputUVTex());
+    glBindBufferBase(GL_UNIFORM_BUFFER, BlurKernelBinding, m_blurKernelUBO);
+
+    dispatchBlur(*blur, blurInputIrradianceTex(), m_blurFBTmpColorTex, Vec2f(1.0f, 0.0f));
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    dispatchBlur(*blur, m_blurFBTmpColorTex, m_blurFBColorTex, Vec2f(0.0f, 1.0f));
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+    glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+    glBindTextureUnit(0, 0);
+    glBindTextureUnit(3, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, BlurKernelBinding, 0);
+  }
+
+  void dispatchBlur(const BlurProgram& blur, GLuint colorTex, GLuint outTex,
+                    const Vec2f& direction) const {
+    glBindTextureUnit(0, colorTex);
+    glBindImageTexture(0, outTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+    setBlurUniforms(blur, direction);
+
+    // One work group per segment of a row (or column).
+    const bool horizontal = direction.x != 0.0f;
+    const GLuint len = (GLuint)(horizontal ? m_blurW : m_blurH);
+    const GLuint lines = (GLuint)(horizontal ? m_blurH : m_blurW);
+
+    blur.program.use();
+    glDispatchCompute((len + BlurComputeGroupSize - 1) / BlurComputeGroupSize, lines, 1);
+  }
+
+  // The pre-integrated mode diffuses the lighting in the G-buffer pass instead.
+  bool blurEnabled() const {
+    return m_enableBlur && m_skinDiffusionMode == SkinDiffusionMode::ScreenSpace;
+  }
+
+  int blurNumSamples() const {
+    return m_diffusionEngine == DiffusionEngine::Burley ? m_burleyKernel.numSamples()
+                                                        : m_blurKernel.numSamples();
+  }
+
+  void setBlurUniforms(const BlurProgram& blur, const Vec2f& direction) const {
+    const ShaderProgram& program = blur.program;
+    const BlurUniforms& uniforms = blur.uniforms;
+    program.setFloat(uniforms.fovy, m_cam.fovy());
+    program.setFloat(uniforms.sssWidth, m_SSSWidth);
+    program.setInt(uniforms.numSamples, blurNumSamples());
+    program.setVec3(uniforms.falloff, m_falloff);
+    program.setVec3(uniforms.strength, m_strength);
+    program.setFloat(uniforms.photonPathLength, m_photonPathLength);
+    program.setVec2(uniforms.direction, direction);
+    program.setFloat(uniforms.resolutionScale, (float)blurScale());
+    program.setInt(uniforms.tapStride, m_blurTapStride);
+    program.setInt(uniforms.tapOffset, blurTapOffset(direction));
+    // Golden ratio increments spread the rotations of consecutive frames.
+    program.setFloat(uniforms.rotation, TwoPi * glm::fract((float)m_blurFrame * 0.618034f));
+  }
+
+  // Adds the diffuse lighting of the scene lights to the G-buffer irradiance, in place.
+  void lightCullingPass() const {
+    glBindTextureUnit(0, m_GBufNormalTex);
+    glBindTextureUnit(1, m_GBufAlbedoTex);
+    glBindImageTexture(0, m_GBufIrradianceTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA16F);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SceneLightsBinding, m_sceneLightsBuffer);
+
+    const Mat4f& proj = m_cam.projectionMatrix();
+    const ShaderProgram& program = m_lightCullingProgram;
+    program.setInt(m_lightCullingUniforms.numLights, m_numSceneLights);
+    program.setMat4(m_lightCullingUniforms.viewMatrix, m_cam.viewMatrix());
+    program.setMat4(m_lightCullingUniforms.invViewMatrix, glm::inverse(m_cam.viewMatrix()));
+    program.setVec2(m_lightCullingUniforms.projScale, proj[0][0], proj[1][1]);
+    program.use();
+    glDispatchCompute((GLuint)m_numTilesX, (GLuint)m_numTilesY, 1);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT |
+                    GL_FRAMEBUFFER_BARRIER_BIT);
+
+    glBindTextureUnit(0, 0);
+    glBindTextureUnit(1, 0);
+    glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA16F);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SceneLightsBinding, 0);
+  }
+
+  // Lists the tiles covering skin pixels, see sss-classify-tiles.comp.
+  void tileClassificationPass() const {
+    // Reset the instance counts, the tiles are appended by the shader.
+    DrawArraysIndirectCommand commands[2];
+    commands[0].count = commands[1].count = 6;
+    glNamedBufferSubData(m_tileListsBuffer, 0, sizeof(commands), commands);
+
+    glBindTextureUnit(0, m_GBufIrradianceTex);
+    glBindTextureUnit(1, m_GBufStencilView);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, TileListsBinding, m_tileListsBuffer);
+
+    m_tileClassificationProgram.setInt(m_tileClassificationUniforms.maxTiles, (int)m_maxTiles);
+    m_tileClassificationProgram.use();
+    glDispatchCompute((GLuint)m_numTilesX, (GLuint)m_numTilesY, 1);
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+
+    glBindTextureUnit(0, 0);
+    glBindTextureUnit(1, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, TileListsBinding, 0);
+  }
+
+  // Draws the edge tiles with the current stencil test, and the interior tiles without it since
+  // they are fully covered.
+  void drawTiles(const ShaderProgram& edgeProgram, const TileUniforms& edgeUniforms,
+                 const ShaderProgram& interiorProgram, const TileUniforms& interiorUniforms) const {
+    const Vec2f viewportSize((float)m_viewportW, (float)m_viewportH);
+    edgeProgram.setInt(edgeUniforms.tileOffset, 0);
+    edgeProgram.setVec2(edgeUniforms.viewportSize, viewportSize);
+
+    glBindVertexArray(m_tileVA);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_tileListsBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, TileListsBinding, m_tileListsBuffer);
+
+    edgeProgram.use();
+    glDrawArraysIndirect(GL_TRIANGLES, nullptr);
+
+    // Set after the edge draw, both programs may be the same.
+    interiorProgram.setInt(interiorUniforms.tileOffset, (int)m_maxTiles);
+    interiorProgram.setVec2(interiorUniforms.viewportSize, viewportSize);
+
+    glDisable(GL_STENCIL_TEST);
+    interiorProgram.use();
+    glDrawArraysIndirect(GL_TRIANGLES, (const void*)sizeof(DrawArraysIndirectCommand));
+    glEnable(GL_STENCIL_TEST);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, TileListsBinding, 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    glBindVertexArray(0);
+  }
+
+  // Decodes the visualized target of the G-buffer, the layout is not displayable as is.
+  void GBufVisPass() const {
+    glViewport(0, 0, m_viewportW, m_viewportH);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_GBufVisFB);
+    glDisable(GL_DEPTH_TEST);
+
+    glBindTextureUnit(0, m_GBufDepthStencilTex);
+    glBindTextureUnit(1, m_GBufUVTex);
+    glBindTextureUnit(2, m_GBufNormalTex);
+    glBindTextureUnit(3, m_GBufAlbedoTex);
+    glBindTextureUnit(4, m_GBufIrradianceTex);
+
+    m_GBufVisProgram.setMat4(m_GBufVisUniforms.invViewProj,
+                             glm::inverse(m_cam.projectionMatrix() * m_cam.viewMatrix()));
+    m_GBufVisProgram.setInt(m_GBufVisUniforms.target, (int)m_GBufVisTextureIndex);
+    m_quad.render(m_GBufVisProgram);
+
+    for (GLuint unit = 0; unit < 5; ++unit)
+      glBindTextureUnit(unit, 0);
+    glEnable(GL_DEPTH_TEST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  }
+
   void finalOutputPass() const {
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
@@ -876,12 +2909,13 @@ private:
   float m_avgDeltaT = 0.0f;
   float m_elapsed = 0.0f;
   size_t m_numFrames = 0;
+  GPUTimer m_passTimers[NumPassTimers];
 
   BaseCamera& m_cam = m_trackballCam;
   TrackballCamera m_trackballCam;
 
-  ShaderProgram m_mainProgram;
-  MainUniforms m_mainUniforms;
+  ShaderProgram m_mainPrograms[NumMainVariants];
+  MainUniforms m_mainUniforms[NumMainVariants];
   MaterialMeshModel m_model;
   Texture m_modelSkinColorlessTex;
   Texture m_modelSkinParamMap;
@@ -891,14 +2925,93 @@ private:
   GLuint m_blurFB = 0;
   GLuint m_blurFBColorTex = 0;
   GLuint m_blurFBStencilTex = 0;
-  ShaderProgram m_blurProgram;
-  BlurUniforms m_blurUniforms;
+  GLuint m_blurTmpFB = 0;
+  GLuint m_blurFBTmpColorTex = 0;
+  GLsizei m_blurW = 0;
+  GLsizei m_blurH = 0;
+  BlurResolution m_blurFBResolution = BlurResolution::Full;
+  GLuint m_blurLowResFB = 0;
+  GLuint m_blurLowResIrradianceTex = 0;
+  GLuint m_blurLowResUVTex = 0;
+  GLuint m_blurLowResNormalTex = 0;
+  GLuint m_blurLowResDepthStencilTex = 0;
+  ShaderProgram m_blurDownsampleProgram;
+  BlurDownsampleUniforms m_blurDownsampleUniforms;
+
+  // Temporal accumulation.
+  GLuint m_blurHistoryFBs[2] = {};
+  GLuint m_blurHistoryTexs[2] = {};
+  GLuint m_blurPrevDepthTex = 0;
+  int m_blurHistoryIndex = 0;
+  bool m_blurHistoryValid = false;
+  uint64_t m_blurHistoryKey = 0;
+  Mat4f m_blurPrevViewProj = Mat4fId;
+  unsigned m_blurFrame = 0;
+  int m_blurTapStride = 1;
+  ShaderProgram m_blurTemporalProgram;
+  BlurTemporalUniforms m_blurTemporalUniforms;
+  std::map<unsigned, BlurProgram> m_blurPrograms;
+  SeparableKernel m_blurKernel;
+  GLuint m_blurKernelUBO = 0;
+  BurleyKernel m_burleyKernel;
+  GLuint m_burleyKernelUBO = 0;
+
+  // Declared before the pool, whose tasks push to it until they are joined.
+  UploadQueue m_uploads;
+  ThreadPool m_threadPool;
+  FileCache m_fileCache{CacheDir};
+  // GL thread only, incremented by the requests and decremented by their uploads.
+  int m_numPendingLoads = 0;
+  GLuint m_placeholderTex = 0;
+  std::chrono::steady_clock::time_point m_initTime;
+  bool m_loggedFirstFrame = false;
+  bool m_loggedAssetsResident = false;
+  PreIntegratedLUT m_preIntegratedLUT;
+  GLuint m_preIntegratedLUTTex = 0;
+  // Read by the workers to drop superseded builds.
+  std::atomic<unsigned> m_preIntegratedRequest = 0;
+  Vec3f m_preIntegratedRequestedFalloff = Vec3fZero;
+  float m_preIntegratedRequestedMaxCurvature = 0.0f;
+
+  // Texture-space diffusion.
+  GLuint m_TSDFB = 0;
+  GLuint m_TSDIrradianceTex = 0;
+  GLuint m_TSDDepthTex = 0;
+  GLuint m_TSDBlurFBs[2] = {};
+  GLuint m_TSDTmpTex = 0;
+  GLuint m_TSDChainTex = 0;
+  GLuint m_TSDAccumTex = 0;
+  uint64_t m_TSDKey = 0;
+  bool m_TSDValid = false;
+  ShaderProgram m_TSDIrradianceProgram;
+  GBufUniforms m_TSDIrradianceUniforms;
+  ShaderProgram m_TSDBlurProgram;
+  TSDBlurUniforms m_TSDBlurUniforms;
+
+  TransmittanceLUT m_transmittanceLUT;
+  GLuint m_transmittanceLUTTex = 0;
+
+  SpecularLUT m_specularLUT;
+  GLuint m_specularLUTTex = 0;
 
   Light m_light;
   GLuint m_shadowDepthTex = 0;
+  GLuint m_shadowLinearDepthTex = 0;
   GLuint m_shadowFB = 0;
   ShaderProgram m_shadowProgram;
   ShadowUniforms m_shadowUniforms;
+  uint64_t m_shadowKey = 0;
+  bool m_shadowValid = false;
+  GLuint m_shadowBlurTmpTex = 0;
+  GLuint m_shadowBlurFBs[2] = {};
+  ShaderProgram m_shadowBlurProgram;
+  ShadowBlurUniforms m_shadowBlurUniforms;
+
+  GLuint m_sceneLightsBuffer = 0;
+  uint64_t m_sceneLightsKey = 0;
+  bool m_sceneLightsValid = false;
+  ShaderProgram m_lightCullingProgram;
+  LightCullingUniforms m_lightCullingUniforms;
 
   // Config.
   bool m_showConfig = false;
@@ -913,40 +3026,104 @@ private:
   float m_SSSWeight = 0.5f;
   float m_SSSWidth = 0.015f;
   float m_SSSNormalBias = 0.3f;
+  int m_numSceneLights = 0;
+  float m_sceneLightIntensity = 0.5f;
+  ShadowMode m_shadowMode = ShadowMode::LinearDepth;
+  int m_shadowBlurRadius = 3;
+  float m_VSMBleedReduction = 0.3f;
+  bool m_enableSpecular = true;
+  // Beckmann roughness and rho_s of the GPU Gems 3 skin.
+  float m_specularRoughness = 0.3f;
+  float m_specularIntensity = 0.18f;
   int m_nSamples = 20;
+  int m_nBurleySamples = 16;
+  DiffusionEngine m_diffusionEngine = DiffusionEngine::Separable;
+  SkinDiffusionMode m_skinDiffusionMode = SkinDiffusionMode::ScreenSpace;
+  float m_curvatureScale = 1000.0f;
   Vec3f m_falloff = Vec3f(1.0f, 0.37f, 0.3f);
   Vec3f m_strength = Vec3f(0.48f, 0.41f, 0.28f);
   float m_photonPathLength = 2.f;
+  bool m_usePerFragmentKernel = false;
+  BlurMode m_blurMode = BlurMode::TwoPass;
+  BlurBackend m_blurBackend = BlurBackend::Fragment;
+  BlurResolution m_blurResolution = BlurResolution::Full;
+  bool m_useTiles = true;
+  bool m_useTemporalBlur = false;
+  int m_temporalTapsPerFrame = 6;
+  int m_temporalMaxFrames = 32;
   unsigned int m_GBufVisTextureIndex = 0;
 
   float m_B = 0.3f, m_S = 74.5f, m_F = 32.f, m_W = 40.f, m_M = 17.f;
 
+  // Spectral albedo, see skin-albedo.comp.
+  SpectralSkinLUT m_skinAlbedoLUT;
+  GLuint m_skinAlbedoLUTTex = 0;
+  ShaderProgram m_skinAlbedoProgram;
+  SkinAlbedoUniforms m_skinAlbedoUniforms;
+  SpectralSkinBenchmark m_spectralBenchmark;
+  // Read by the workers to drop superseded builds.
+  std::atomic<unsigned> m_skinAlbedoRequest = 0;
+  float m_skinAlbedoRequestedF = -1.0f;
+  float m_skinAlbedoRequestedW = -1.0f;
+
   GLuint m_mainFB = 0;
   GLuint m_mainFBColorTex = 0;
   GLuint m_mainFBDepthStencilTex = 0;
   QuadMesh m_quad;
+
+  // Tile classification.
+  GLsizei m_numTilesX = 0;
+  GLsizei m_numTilesY = 0;
+  GLsizei m_maxTiles = 0;
+  GLuint m_tileListsBuffer = 0;
+  GLuint m_tileVA = 0;
+  ShaderProgram m_tileClassificationProgram;
+  TileClassificationUniforms m_tileClassificationUniforms;
   ShaderProgram m_finalOutputProgram;
   FinalOutputUniforms m_finalOutputUniforms;
 
   Texture m_kernelSizeTex;
 
   // Env map.
-  GLuint m_envMapFB = 0;
   GLuint m_envColorCubeMap = 0;
-  GLuint m_envIrradianceCubeMap = 0;
+  GLsizei m_envColorSize = 0;
+  GLsizei m_envColorNumLevels = 0;
+  // Finest level of the chain allocated in m_envColorCubeMap.
+  GLint m_envBaseLevel = 0;
+  bool m_envRequestPending = false;
+  // Copy of a converted cube map on its way to the cache, see beginEnvReadback().
+  struct EnvReadback {
+    GLuint buffer = 0;
+    GLsync fence = nullptr;
+    GLuint query = 0;
+    const char* mapped = nullptr;
+    size_t numCopied = 0;
+    uint64_t key = 0;
+    std::shared_ptr<std::vector<char>> data;
+  };
+  EnvReadback m_envReadback;
+  IrradianceSH9 m_envIrradianceSH;
   CubeMesh m_cube;
   ShaderProgram m_skyBoxProgram;
   SkyBoxUniforms m_skyBoxUniforms;
 
   GLuint m_GBufFB = 0;
-  GLuint m_GBufPosTex = 0;
   GLuint m_GBufUVTex = 0;
   GLuint m_GBufNormalTex = 0;
   GLuint m_GBufAlbedoTex = 0;
   GLuint m_GBufIrradianceTex = 0;
   GLuint m_GBufDepthStencilTex = 0;
+  // Stencil of m_GBufDepthStencilTex, for the tile classification.
+  GLuint m_GBufStencilView = 0;
   GBufUniforms m_GBufUniforms;
   ShaderProgram m_GBufProgram;
+  GLint m_GBufBitsPerPixel = 0;
+
+  GLuint m_GBufVisFB = 0;
+  GLuint m_GBufVisTex = 0;
+  bool m_showGBufVis = false;
+  ShaderProgram m_GBufVisProgram;
+  GBufVisUniforms m_GBufVisUniforms;
 };
 
 int main(int argc, char** argv) {
@@ -0,0 +1,44 @@
+#pragma once
+#ifndef SSS_MODEL_AABB_H
+#define SSS_MODEL_AABB_H
+
+#include "../MathDefines.h"
+
+namespace sss {
+
+// Axis-aligned bounding box, empty until a point is added.
+struct AABB {
+  Vec3f min = Vec3f(Inf);
+  Vec3f max = Vec3f(-Inf);
+
+  bool isEmpty() const { return min.x > max.x; }
+
+  void expand(const Vec3f& p) {
+    min = glm::min(min, p);
+    max = glm::max(max, p);
+  }
+
+  void expand(const AABB& other) {
+    min = glm::min(min, other.min);
+    max = glm::max(max, other.max);
+  }
+
+  Vec3f corner(int i) const {
+    return Vec3f(i & 1 ? max.x : min.x, i & 2 ? max.y : min.y, i & 4 ? max.z : min.z);
+  }
+
+  // Box around the transformed corners.
+  AABB transformed(const Mat4f& m) const {
+    AABB box;
+    if (isEmpty())
+      return box;
+
+    for (int i = 0; i < 8; ++i)
+      box.expand(Vec3f(m * Vec4f(corner(i), 1.0f)));
+    return box;
+  }
+};
+
+} // namespace sss
+
+#endif
@@ -1,60 +1,30 @@
 #include "MaterialMesh.h"
-#include "../utils/Image.h"
 #include "SSSConfig.h"
 
 namespace sss {
 
-Texture Texture::load(const std::string& path) {
-  const char* path_str = path.c_str();
+Texture Texture::load(const std::string& path, TextureUsage usage) {
+  EncodedTexture encoded;
+  if (!readTexture(SSS_ASSET_DIR "/" + path, usage, false, encoded))
+    return {};
 
+  return create(encoded, path);
+}
+
+Texture Texture::create(const EncodedTexture& encoded, const std::string& path) {
   Texture texture;
-  RGBImage image;
-  const std::string fullPath = SSS_ASSET_DIR "/" + path;
-  if (!image.load(fullPath)) {
-    texture.id = GL_INVALID_INDEX;
-    return texture;
-  }
-
-  glCreateTextures(GL_TEXTURE_2D, 1, &texture.id);
-  texture.path = path_str;
+  texture.id = uploadTexture(encoded);
+  texture.path = path;
   texture.type = "diffuse";
-
-  GLenum format = GL_INVALID_ENUM;
-  GLenum internalFormat = GL_INVALID_ENUM;
-  if (image.nbChannels() == 1) {
-    format = GL_RED;
-    internalFormat = GL_R8;
-  } else if (image.nbChannels() == 2) {
-    format = GL_RG;
-    internalFormat = GL_RG8;
-  } else if (image.nbChannels() == 3) {
-    format = GL_RGB;
-    internalFormat = GL_RGB8;
-  } else {
-    format = GL_RGBA;
-    internalFormat = GL_RGBA8;
-  }
-
-  // Deduce the number of mipmaps.
-  int w = image.width();
-  int h = image.height();
-  int mips = (int)glm::log2((float)glm::max(w, h));
-  glTextureStorage2D(texture.id, mips, internalFormat, w, h);
-  glTextureParameteri(texture.id, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTextureParameteri(texture.id, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  glTextureParameteri(texture.id, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-  glTextureParameteri(texture.id, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-  glTextureSubImage2D(texture.id, 0, 0, 0, w, h, format, GL_UNSIGNED_BYTE, image.pixels());
-  glGenerateTextureMipmap(texture.id);
   return texture;
 }
 
 bool Texture::isValid() const { return id != GL_INVALID_INDEX; }
 
 void Texture::release() {
-  glDeleteTextures(1, &id);
-  id = 0;
+  if (isValid())
+    glDeleteTextures(1, &id);
+  id = GL_INVALID_INDEX;
 }
 
 void MaterialMeshVertex::initBindings(GLuint va) {
@@ -92,6 +62,14 @@ void MaterialMesh::init(const std::string& name, const std::vector<MaterialMeshV
   Mesh::init(vertices, indices);
 }
 
+void MaterialMesh::init(const std::string& name, const MaterialMeshVertex* vertices,
+                        size_t numVertices, const unsigned int* indices, size_t numIndices,
+                        const Material& material) {
+  m_material = material;
+  m_name = name;
+  Mesh::init(vertices, numVertices, indices, numIndices);
+}
+
 void MaterialMesh::render(const ShaderProgram& program) const {
   loadUniforms(program);
 
@@ -121,10 +99,13 @@ void MaterialMesh::renderForGBuf(const ShaderProgram& program) const {
 
   if (m_material.hasNormalMap)
     glBindTextureUnit(2, m_material.normalMap.id);
+  if (m_material.hasSpecularMap)
+    glBindTextureUnit(7, m_material.specularMap.id);
 
   Mesh::render(program);
 
   glBindTextureUnit(2, 0);
+  glBindTextureUnit(7, 0);
 }
 
 void MaterialMesh::bindAlbedo(GLuint binding) const {
@@ -150,6 +131,7 @@ void MaterialMesh::loadUniforms(const ShaderProgram& program) const {
 
 void MaterialMesh::loadGBufUniforms(const ShaderProgram& program) const {
   program.setBool(program.getUniformLocation("uHasNormalMap"), m_material.hasNormalMap);
+  program.setBool(program.getUniformLocation("uHasSpecularMap"), m_material.hasSpecularMap);
 }
 
 } // namespace sss
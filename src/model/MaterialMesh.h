@@ -2,6 +2,7 @@
 #ifndef SSS_MODEL_TRIANGLEMESH_H
 #define SSS_MODEL_TRIANGLEMESH_H
 
+#include "../utils/TextureEncoder.h"
 #include "Mesh.h"
 
 #include <glad/glad.h>
@@ -21,11 +22,14 @@ struct MaterialMeshVertex {
 };
 
 struct Texture {
-  unsigned int id;
+  unsigned int id = GL_INVALID_INDEX;
   std::string type;
   std::string path;
 
-  static Texture load(const std::string& path);
+  // path is relative to the asset directory. Not compressed, see loadEncodedTexture().
+  static Texture load(const std::string& path, TextureUsage usage = TextureUsage::Data);
+  // GL thread side of load(), the texture can be encoded on any thread.
+  static Texture create(const EncodedTexture& encoded, const std::string& path);
 
   bool isValid() const;
   void release();
@@ -62,6 +66,8 @@ public:
 
   void init(const std::string& name, const std::vector<MaterialMeshVertex>& vertices,
             const std::vector<unsigned int>& indices, const Material& material);
+  void init(const std::string& name, const MaterialMeshVertex* vertices, size_t numVertices,
+            const unsigned int* indices, size_t numIndices, const Material& material);
 
   void render(const ShaderProgram& program) const override;
   void renderForGBuf(const ShaderProgram& program) const override;
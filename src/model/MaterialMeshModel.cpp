@@ -1,41 +1,313 @@
 #include "MaterialMeshModel.h"
-#include "../utils/Image.h"
+#include "../utils/FileCache.h"
+#include "../utils/MappedFile.h"
 
+#include <algorithm>
 #include <assimp/Importer.hpp>
 #include <assimp/postprocess.h>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <numeric>
 
 namespace sss {
 
-bool MaterialMeshModel::load(const std::string& name, const Path& path) {
-  m_name = name;
-  std::cout << "Loading model \"" << this->name() << "\" from \"" << path << "\"" << std::endl;
-  m_baseDir = path.dir();
+namespace {
+
+// Bump when the layout below or MaterialMeshVertex changes.
+constexpr uint32_t MeshCacheVersion = 1;
+constexpr uint32_t MeshCacheMagic = 0x48534d53; // "SMSH"
+
+// Flags of MeshCacheMaterial, after one bit per map of MaterialMaps.
+constexpr uint32_t MeshCacheOpaque = 1u << 5;
+constexpr uint32_t MeshCacheLiquid = 1u << 6;
+
+struct MaterialMap {
+  Texture Material::*texture;
+  bool Material::*hasMap;
+  const char* type;
+  TextureUsage usage;
+};
+
+constexpr int NumMaterialMaps = 5;
+const MaterialMap MaterialMaps[NumMaterialMaps] = {
+  {&Material::ambientMap, &Material::hasAmbientMap, "ambient", TextureUsage::Color},
+  {&Material::diffuseMap, &Material::hasDiffuseMap, "diffuse", TextureUsage::Color},
+  {&Material::specularMap, &Material::hasSpecularMap, "specular", TextureUsage::Mono},
+  {&Material::shininessMap, &Material::hasShininessMap, "shininess", TextureUsage::Mono},
+  {&Material::normalMap, &Material::hasNormalMap, "normal", TextureUsage::Normal},
+};
+
+// Cache layout: the header, then for each mesh a MeshCacheMesh followed by its name, the paths
+// of its maps, its vertices and its indices. Every blob starts on a 4-byte boundary.
+struct MeshCacheHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t key;
+  uint64_t size;
+  uint32_t numMeshes;
+  Vec3f boundsMin;
+  Vec3f boundsMax;
+};
+
+struct MeshCacheMaterial {
+  Vec3f ambient;
+  Vec3f diffuse;
+  Vec3f specular;
+  float shininess;
+  float normal;
+  uint32_t flags;
+  uint32_t mapPathSizes[NumMaterialMaps];
+};
+
+struct MeshCacheMesh {
+  uint32_t nameSize;
+  uint32_t numVertices;
+  uint32_t numIndices;
+  MeshCacheMaterial material;
+};
+
+void appendCache(std::vector<char>& cache, const void* data, size_t size) {
+  const size_t offset = cache.size();
+  cache.resize((offset + size + 3) & ~(size_t)3);
+  if (size)
+    std::memcpy(cache.data() + offset, data, size);
+}
+
+template <typename T> void appendCache(std::vector<char>& cache, const T& value) {
+  appendCache(cache, &value, sizeof(T));
+}
+
+// Bounds-checked cursor over a mapped cache.
+class MeshCacheReader {
+public:
+  MeshCacheReader(const char* data, size_t size)
+    : m_cur(data)
+    , m_end(data + size) {}
+
+  // Null if the file is too short.
+  template <typename T> const T* read(size_t count = 1) {
+    return (const T*)readBytes(count * sizeof(T));
+  }
+
+  bool readString(size_t size, std::string& outStr) {
+    const char* str = readBytes(size);
+    if (!str)
+      return false;
+    outStr.assign(str, size);
+    return true;
+  }
+
+private:
+  const char* readBytes(size_t size) {
+    if ((size_t)(m_end - m_cur) < size)
+      return nullptr;
+
+    const char* data = m_cur;
+    const size_t padded = (size + 3) & ~(size_t)3;
+    m_cur += std::min(padded, (size_t)(m_end - m_cur));
+    return data;
+  }
+
+private:
+  const char* m_cur;
+  const char* m_end;
+};
+
+// Map enabled by MaterialMeshModel::attachTexture() once its texture is resident.
+Texture pendingMap(const std::string& path, const char* type) {
+  Texture texture;
+  texture.path = path;
+  texture.type = type;
+  return texture;
+}
+
+bool isSpace(char c) { return std::isspace((unsigned char)c) != 0; }
+
+// Material libraries named by the mtllib statements of an OBJ file, which Assimp imports with it.
+// The rest of the line is the file name, as Assimp reads it.
+std::vector<std::string> objMaterialLibraries(const char* data, size_t size) {
+  constexpr char Statement[] = "mtllib";
+  constexpr size_t StatementSize = sizeof(Statement) - 1;
+
+  std::vector<std::string> libraries;
+  const char* const end = data + size;
+  for (const char* line = data; line < end;) {
+    const char* lineEnd = std::find(line, end, '\n');
+    while (line < lineEnd && isSpace(*line))
+      ++line;
+
+    if ((size_t)(lineEnd - line) > StatementSize &&
+        std::memcmp(line, Statement, StatementSize) == 0 && isSpace(line[StatementSize])) {
+      const char* name = line + StatementSize;
+      const char* nameEnd = lineEnd;
+      while (name < nameEnd && isSpace(*name))
+        ++name;
+      while (nameEnd > name && isSpace(nameEnd[-1]))
+        --nameEnd;
+      if (name < nameEnd)
+        libraries.emplace_back(name, nameEnd);
+    }
+    line = lineEnd < end ? lineEnd + 1 : end;
+  }
+  return libraries;
+}
+
+// Change of the vertex normals over the length of each edge.
+float estimateMaxCurvature(const MaterialMeshModelData& data) {
+  std::vector<float> curvatures;
+  for (const MaterialMeshModelData::MeshData& mesh : data.meshes) {
+    curvatures.reserve(curvatures.size() + mesh.numIndices);
+    for (size_t i = 0; i + 2 < mesh.numIndices; i += 3) {
+      for (size_t e = 0; e < 3; ++e) {
+        const MaterialMeshVertex& a = mesh.vertices[mesh.indices[i + e]];
+        const MaterialMeshVertex& b = mesh.vertices[mesh.indices[i + (e + 1) % 3]];
+        const float length = glm::length(a.position - b.position);
+        if (length > 0.0f)
+          curvatures.push_back(glm::length(a.normal - b.normal) / length);
+      }
+    }
+  }
+  if (curvatures.empty())
+    return 0.0f;
+
+  const auto percentile = curvatures.begin() + (std::ptrdiff_t)(curvatures.size() * 95 / 100);
+  std::nth_element(curvatures.begin(), percentile, curvatures.end());
+  return *percentile;
+}
+
+} // namespace
+
+bool MaterialMeshModel::read(const std::string& name, const Path& path,
+                             MaterialMeshModelData& outData) {
+  std::cout << "Loading model \"" << name << "\" from \"" << path << "\"" << std::endl;
+  const auto start = std::chrono::steady_clock::now();
+
+  outData = MaterialMeshModelData();
+  outData.name = name;
+  outData.baseDir = path.dir();
 
-  Assimp::Importer importer;
   // Importer options.
   // See http://assimp.sourceforge.net/lib_html/postprocess_8h.html.
   constexpr unsigned int flags = aiProcessPreset_TargetRealtime_Fast | aiProcess_FlipUVs;
 
-  const aiScene* scene = importer.ReadFile(path.cstr(), flags);
-  if (!scene) {
-    std::cout << "Failed to load scene: " << importer.GetErrorString() << std::endl;
+  MappedFile source;
+  if (!source.open(path)) {
+    std::cout << "Failed to open \"" << path << "\"" << std::endl;
     return false;
   }
 
-  m_meshes.reserve(scene->mNumMeshes);
-  for (unsigned int i = 0; i < scene->mNumMeshes; ++i)
-    loadMesh(scene->mMeshes[i], scene);
-  m_meshes.shrink_to_fit();
+  uint64_t key = fnv1a(MeshCacheVersion);
+  key = fnv1a(flags, key);
+  key = fnv1a(sizeof(MaterialMeshVertex), key);
+  key = fnv1a(source.data(), source.size(), key);
+  // The materials are cached too, from the libraries the model names.
+  std::string ext = path.ext();
+  std::transform(ext.begin(), ext.end(), ext.begin(), [](char c) { return (char)std::tolower(c); });
+  const std::vector<std::string> libraries =
+    ext == "obj" ? objMaterialLibraries(source.data(), source.size()) : std::vector<std::string>();
+  source.close();
+  for (const std::string& library : libraries) {
+    key = fnv1a(library.data(), library.size(), key);
+    const bool opened = source.open(path.dir() + library);
+    key = fnv1a(opened, key);
+    if (opened) {
+      key = fnv1a(source.data(), source.size(), key);
+      source.close();
+    }
+  }
+
+  const Path cachePath = path.str() + ".meshcache";
+  outData.fromCache = readCache(cachePath, key, outData);
+  if (!outData.fromCache) {
+    std::vector<char> cache;
+    if (!import(path, flags, outData, cache))
+      return false;
 
-  // Separate opaque/transparent objects.
-  std::partition(m_meshes.begin(), m_meshes.end(),
-                 [](const MaterialMesh& mesh) { return mesh.m_material.isOpaque; });
+    MeshCacheHeader& header = *(MeshCacheHeader*)cache.data();
+    header.key = key;
+    header.size = cache.size();
 
-  std::cout << "Done:\n"
+    std::ofstream file(cachePath.str(), std::ios::binary | std::ios::trunc);
+    if (!file.is_open() || !file.write(cache.data(), (std::streamsize)cache.size()))
+      std::cout << "Failed to write mesh cache \"" << cachePath << "\"" << std::endl;
+  }
+  outData.maxCurvature = estimateMaxCurvature(outData);
+
+  for (const MaterialMeshModelData::MeshData& mesh : outData.meshes) {
+    for (const MaterialMap& map : MaterialMaps) {
+      const std::string& mapPath = (mesh.material.*map.texture).path;
+      if (!(mesh.material.*map.hasMap))
+        continue;
+
+      const auto sameTexture = [&mapPath](const MaterialMeshModelData::TextureData& texture) {
+        return texture.path == mapPath;
+      };
+      if (std::none_of(outData.textures.begin(), outData.textures.end(), sameTexture))
+        outData.textures.push_back({mapPath, map.usage});
+    }
+  }
+
+  const std::chrono::duration<float, std::milli> elapsed =
+    std::chrono::steady_clock::now() - start;
+  std::cout << "Model \"" << name << "\" read from "
+            << (outData.fromCache ? "mesh cache" : "Assimp") << " in " << elapsed.count() << " ms"
+            << std::endl;
+  return true;
+}
+
+void MaterialMeshModel::upload(const MaterialMeshModelData& data) {
+  release();
+  m_name = data.name;
+  m_baseDir = data.baseDir;
+  m_bounds = data.bounds;
+  m_maxCurvature = data.maxCurvature;
+
+  // Separate opaque/transparent objects. The meshes own GL objects, they are ordered before being
+  // created rather than swapped afterwards.
+  std::vector<size_t> order(data.meshes.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_partition(order.begin(), order.end(),
+                        [&data](size_t i) { return data.meshes[i].material.isOpaque; });
+
+  m_meshes.resize(data.meshes.size());
+  for (size_t i = 0; i < data.meshes.size(); ++i) {
+    const MaterialMeshModelData::MeshData& mesh = data.meshes[order[i]];
+
+    // The maps are enabled as their textures arrive.
+    Material material = mesh.material;
+    for (const MaterialMap& map : MaterialMaps)
+      material.*map.hasMap = false;
+
+    m_meshes[i].init(mesh.name, mesh.vertices, mesh.numVertices, mesh.indices, mesh.numIndices,
+                     material);
+    m_nbTriangles += (unsigned int)(mesh.numIndices / 3);
+    m_nbVertices += (unsigned int)mesh.numVertices;
+  }
+
+  std::cout << "Model \"" << name() << "\" uploaded:\n"
             << "> " << m_meshes.size() << " mesh(es)\n"
             << "> " << m_nbTriangles << " triangles\n"
             << "> " << m_nbVertices << " vertices" << std::endl;
-  return true;
+}
+
+void MaterialMeshModel::attachTexture(const std::string& path, const EncodedTexture& encoded) {
+  const Texture texture = Texture::create(encoded, path);
+  m_loadedTextures.push_back(texture);
+
+  for (MaterialMesh& mesh : m_meshes) {
+    for (const MaterialMap& map : MaterialMaps) {
+      Texture& meshMap = mesh.m_material.*map.texture;
+      if (meshMap.path != path)
+        continue;
+
+      // One texture can be used for more than one type.
+      meshMap.id = texture.id;
+      mesh.m_material.*map.hasMap = true;
+    }
+  }
 }
 
 void MaterialMeshModel::render(const ShaderProgram& program) const {
@@ -49,19 +321,116 @@ void MaterialMeshModel::renderForGBuf(const ShaderProgram& program) const {
 }
 
 void MaterialMeshModel::bindMeshAlbedo(size_t meshIndex, GLuint binding) const {
-  m_meshes[meshIndex].bindAlbedo(binding);
+  if (meshIndex < m_meshes.size())
+    m_meshes[meshIndex].bindAlbedo(binding);
 }
 
 void MaterialMeshModel::release() {
-  for (MaterialMesh& m : m_meshes)
-    m.release();
+  m_meshes.clear();
   for (const Texture& t : m_loadedTextures)
     glDeleteTextures(1, &t.id);
   m_loadedTextures.clear();
+  m_bounds = AABB();
+  m_maxCurvature = 0.0f;
+  m_nbTriangles = 0;
+  m_nbVertices = 0;
 }
 
-void MaterialMeshModel::loadMesh(const aiMesh* mesh, const aiScene* scene) {
-  const std::string meshName = name() + "_" + std::string(mesh->mName.C_Str());
+bool MaterialMeshModel::readCache(const Path& cachePath, uint64_t key,
+                                  MaterialMeshModelData& outData) {
+  auto file = std::make_unique<MappedFile>();
+  if (!file->open(cachePath))
+    return false;
+
+  MeshCacheReader reader(file->data(), file->size());
+  const MeshCacheHeader* header = reader.read<MeshCacheHeader>();
+  if (!header || header->magic != MeshCacheMagic || header->version != MeshCacheVersion ||
+      header->key != key || header->size != file->size()) {
+    std::cout << "Mesh cache \"" << cachePath << "\" is out of date" << std::endl;
+    return false;
+  }
+
+  // Each mesh takes a record at least, a larger count would only allocate.
+  if (header->numMeshes > (file->size() - sizeof(MeshCacheHeader)) / sizeof(MeshCacheMesh)) {
+    std::cout << "Mesh cache \"" << cachePath << "\" is corrupted" << std::endl;
+    return false;
+  }
+
+  // The blobs are uploaded from the mapping directly, it is kept open by outData.
+  std::vector<MaterialMeshModelData::MeshData> meshes(header->numMeshes);
+  for (MaterialMeshModelData::MeshData& mesh : meshes) {
+    const MeshCacheMesh* record = reader.read<MeshCacheMesh>();
+    if (!record || !reader.readString(record->nameSize, mesh.name)) {
+      std::cout << "Mesh cache \"" << cachePath << "\" is corrupted" << std::endl;
+      return false;
+    }
+
+    Material& material = mesh.material;
+    material.ambient = record->material.ambient;
+    material.diffuse = record->material.diffuse;
+    material.specular = record->material.specular;
+    material.shininess = record->material.shininess;
+    material.normal = record->material.normal;
+    material.isOpaque = (record->material.flags & MeshCacheOpaque) != 0;
+    material.isLiquid = (record->material.flags & MeshCacheLiquid) != 0;
+
+    bool valid = true;
+    for (int i = 0; i < NumMaterialMaps; ++i) {
+      std::string mapPath;
+      valid = valid && reader.readString(record->material.mapPathSizes[i], mapPath);
+      if (record->material.flags & (1u << i)) {
+        material.*MaterialMaps[i].texture = pendingMap(mapPath, MaterialMaps[i].type);
+        material.*MaterialMaps[i].hasMap = true;
+      }
+    }
+
+    mesh.numVertices = record->numVertices;
+    mesh.numIndices = record->numIndices;
+    mesh.vertices = reader.read<MaterialMeshVertex>(mesh.numVertices);
+    mesh.indices = reader.read<unsigned int>(mesh.numIndices);
+    if (!valid || !mesh.vertices || !mesh.indices) {
+      std::cout << "Mesh cache \"" << cachePath << "\" is corrupted" << std::endl;
+      return false;
+    }
+  }
+
+  outData.meshes = std::move(meshes);
+  outData.bounds.min = header->boundsMin;
+  outData.bounds.max = header->boundsMax;
+  outData.cacheFile = std::move(file);
+  return true;
+}
+
+bool MaterialMeshModel::import(const Path& path, unsigned int flags,
+                               MaterialMeshModelData& outData, std::vector<char>& outCache) {
+  Assimp::Importer importer;
+  const aiScene* scene = importer.ReadFile(path.cstr(), flags);
+  if (!scene) {
+    std::cout << "Failed to load scene: " << importer.GetErrorString() << std::endl;
+    return false;
+  }
+
+  // The key and the size are filled in once the whole cache is written.
+  MeshCacheHeader header = {};
+  header.magic = MeshCacheMagic;
+  header.version = MeshCacheVersion;
+  header.numMeshes = scene->mNumMeshes;
+  outCache.clear();
+  appendCache(outCache, header);
+
+  outData.meshes.reserve(scene->mNumMeshes);
+  for (unsigned int i = 0; i < scene->mNumMeshes; ++i)
+    loadMesh(scene->mMeshes[i], scene, outData, outCache);
+
+  MeshCacheHeader& written = *(MeshCacheHeader*)outCache.data();
+  written.boundsMin = outData.bounds.min;
+  written.boundsMax = outData.bounds.max;
+  return true;
+}
+
+void MaterialMeshModel::loadMesh(const aiMesh* mesh, const aiScene* scene,
+                                 MaterialMeshModelData& outData, std::vector<char>& cache) {
+  const std::string meshName = outData.name + "_" + std::string(mesh->mName.C_Str());
 
   std::vector<MaterialMeshVertex> vertices;
   vertices.resize(mesh->mNumVertices);
@@ -71,6 +440,7 @@ void MaterialMeshModel::loadMesh(const aiMesh* mesh, const aiScene* scene) {
     vertex.position.x = mesh->mVertices[v].x;
     vertex.position.y = mesh->mVertices[v].y;
     vertex.position.z = mesh->mVertices[v].z;
+    outData.bounds.expand(vertex.position);
     vertex.normal.x = mesh->mNormals[v].x;
     vertex.normal.y = mesh->mNormals[v].y;
     vertex.normal.z = mesh->mNormals[v].z;
@@ -110,11 +480,43 @@ void MaterialMeshModel::loadMesh(const aiMesh* mesh, const aiScene* scene) {
     material = loadMaterial(mtl);
   }
 
-  m_nbTriangles += mesh->mNumFaces;
-  m_nbVertices += mesh->mNumVertices;
+  MeshCacheMesh record = {};
+  record.nameSize = (uint32_t)meshName.size();
+  record.numVertices = (uint32_t)vertices.size();
+  record.numIndices = (uint32_t)indices.size();
+  record.material.ambient = material.ambient;
+  record.material.diffuse = material.diffuse;
+  record.material.specular = material.specular;
+  record.material.shininess = material.shininess;
+  record.material.normal = material.normal;
+  record.material.flags = (material.isOpaque ? MeshCacheOpaque : 0u) |
+                          (material.isLiquid ? MeshCacheLiquid : 0u);
+  for (int i = 0; i < NumMaterialMaps; ++i) {
+    if (material.*MaterialMaps[i].hasMap) {
+      record.material.flags |= 1u << i;
+      record.material.mapPathSizes[i] = (uint32_t)(material.*MaterialMaps[i].texture).path.size();
+    }
+  }
 
-  m_meshes.emplace_back();
-  m_meshes.back().init(meshName, vertices, indices, material);
+  appendCache(cache, record);
+  appendCache(cache, meshName.data(), meshName.size());
+  for (int i = 0; i < NumMaterialMaps; ++i) {
+    const std::string& mapPath = (material.*MaterialMaps[i].texture).path;
+    appendCache(cache, mapPath.data(), record.material.mapPathSizes[i]);
+  }
+  appendCache(cache, vertices.data(), vertices.size() * sizeof(MaterialMeshVertex));
+  appendCache(cache, indices.data(), indices.size() * sizeof(unsigned int));
+
+  outData.meshes.emplace_back();
+  MaterialMeshModelData::MeshData& data = outData.meshes.back();
+  data.name = meshName;
+  data.material = material;
+  data.ownedVertices = std::move(vertices);
+  data.ownedIndices = std::move(indices);
+  data.vertices = data.ownedVertices.data();
+  data.numVertices = data.ownedVertices.size();
+  data.indices = data.ownedIndices.data();
+  data.numIndices = data.ownedIndices.size();
 }
 
 Material MaterialMeshModel::loadMaterial(const aiMaterial* mtl) {
@@ -122,37 +524,27 @@ Material MaterialMeshModel::loadMaterial(const aiMaterial* mtl) {
 
   aiColor3D color;
   aiString texturePath;
-  Texture texture;
 
   if (mtl->GetTextureCount(aiTextureType_AMBIENT) > 0) {
     mtl->GetTexture(aiTextureType_AMBIENT, 0, &texturePath);
-    texture = loadTexture(texturePath, "ambient");
-    if (texture.id != GL_INVALID_INDEX) {
-      material.ambientMap = texture;
-      material.hasAmbientMap = true;
-    }
+    material.ambientMap = pendingMap(texturePath.C_Str(), "ambient");
+    material.hasAmbientMap = true;
   } else if (mtl->Get(AI_MATKEY_COLOR_AMBIENT, color) == AI_SUCCESS) {
     material.ambient = Vec3f(color.r, color.g, color.b);
   }
 
   if (mtl->GetTextureCount(aiTextureType_DIFFUSE) > 0) {
     mtl->GetTexture(aiTextureType_DIFFUSE, 0, &texturePath);
-    texture = loadTexture(texturePath, "diffuse");
-    if (texture.id != GL_INVALID_INDEX) {
-      material.diffuseMap = texture;
-      material.hasDiffuseMap = true;
-    }
+    material.diffuseMap = pendingMap(texturePath.C_Str(), "diffuse");
+    material.hasDiffuseMap = true;
   } else if (mtl->Get(AI_MATKEY_COLOR_DIFFUSE, color) == AI_SUCCESS) {
     material.diffuse = Vec3f(color.r, color.g, color.b);
   }
 
   if (mtl->GetTextureCount(aiTextureType_SPECULAR) > 0) {
     mtl->GetTexture(aiTextureType_SPECULAR, 0, &texturePath);
-    texture = loadTexture(texturePath, "specular");
-    if (texture.id != GL_INVALID_INDEX) {
-      material.specularMap = texture;
-      material.hasSpecularMap = true;
-    }
+    material.specularMap = pendingMap(texturePath.C_Str(), "specular");
+    material.hasSpecularMap = true;
   } else if (mtl->Get(AI_MATKEY_COLOR_SPECULAR, color) == AI_SUCCESS) {
     material.specular = Vec3f(color.r, color.g, color.b);
   }
@@ -160,11 +552,8 @@ Material MaterialMeshModel::loadMaterial(const aiMaterial* mtl) {
   float shininess;
   if (mtl->GetTextureCount(aiTextureType_SHININESS) > 0) {
     mtl->GetTexture(aiTextureType_SHININESS, 0, &texturePath);
-    texture = loadTexture(texturePath, "shininess");
-    if (texture.id != GL_INVALID_INDEX) {
-      material.shininessMap = texture;
-      material.hasShininessMap = true;
-    }
+    material.shininessMap = pendingMap(texturePath.C_Str(), "shininess");
+    material.hasShininessMap = true;
   } else if (mtl->Get(AI_MATKEY_SHININESS, shininess) == AI_SUCCESS) {
     material.shininess = shininess;
   }
@@ -172,11 +561,8 @@ Material MaterialMeshModel::loadMaterial(const aiMaterial* mtl) {
   float normal;
   if (mtl->GetTextureCount(aiTextureType_NORMALS) > 0) {
     mtl->GetTexture(aiTextureType_NORMALS, 0, &texturePath);
-    texture = loadTexture(texturePath, "normal");
-    if (texture.id != GL_INVALID_INDEX) {
-      material.normalMap = texture;
-      material.hasNormalMap = true;
-    }
+    material.normalMap = pendingMap(texturePath.C_Str(), "normal");
+    material.hasNormalMap = true;
   } else if (mtl->Get(AI_MATKEY_TEXTURE(aiTextureType_NORMALS, 0), normal) == AI_SUCCESS) {
     material.normal = normal;
   }
@@ -187,65 +573,4 @@ Material MaterialMeshModel::loadMaterial(const aiMaterial* mtl) {
   return material;
 }
 
-Texture MaterialMeshModel::loadTexture(const aiString& path, const std::string& type) {
-  const char* path_str = path.C_Str();
-
-  // Check if the texture has already been loaded.
-  for (const Texture& t : m_loadedTextures) {
-    if (t.path == path_str) {
-      if (t.type == type) {
-        return t;
-      } else {
-        // One texture can be used for more than one type.
-        Texture texture;
-        texture.id = t.id;
-        texture.path = path_str;
-        texture.type = type;
-        return texture;
-      }
-    }
-  }
-
-  Texture texture;
-  RGBImage image;
-  const std::string fullPath = m_baseDir.str() + "/" + path_str;
-  if (image.load(fullPath)) {
-    glCreateTextures(GL_TEXTURE_2D, 1, &texture.id);
-    texture.path = path_str;
-    texture.type = type;
-
-    GLenum format = GL_INVALID_ENUM;
-    GLenum internalFormat = GL_INVALID_ENUM;
-    if (image.nbChannels() == 1) {
-      format = GL_RED;
-      internalFormat = GL_R32F;
-    } else if (image.nbChannels() == 2) {
-      format = GL_RG;
-      internalFormat = GL_RG32F;
-    } else if (image.nbChannels() == 3) {
-      format = GL_RGB;
-      internalFormat = GL_RGB32F;
-    } else {
-      format = GL_RGBA;
-      internalFormat = GL_RGBA32F;
-    }
-
-    // Deduce the number of mipmaps.
-    int w = image.width();
-    int h = image.height();
-    int mips = (int)glm::log2((float)glm::max(w, h));
-    glTextureStorage2D(texture.id, mips, internalFormat, w, h);
-    glTextureParameteri(texture.id, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTextureParameteri(texture.id, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTextureParameteri(texture.id, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTextureParameteri(texture.id, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    glTextureSubImage2D(texture.id, 0, 0, 0, w, h, format, GL_UNSIGNED_BYTE, image.pixels());
-    glGenerateTextureMipmap(texture.id);
-  }
-
-  m_loadedTextures.emplace_back(texture);
-  return texture;
-}
-
 } // namespace sss
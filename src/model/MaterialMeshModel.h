@@ -2,23 +2,77 @@
 #ifndef SSS_MODELS_TRIANGLEMESHMODEL_H
 #define SSS_MODELS_TRIANGLEMESHMODEL_H
 
+#include "../utils/MappedFile.h"
 #include "../utils/Path.h"
+#include "../utils/TextureEncoder.h"
+#include "AABB.h"
 #include "BaseModel.h"
 #include "MaterialMesh.h"
 
 #include <assimp/scene.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
 
 namespace sss {
 
+// CPU side of a model, filled by MaterialMeshModel::read() on any thread.
+struct MaterialMeshModelData {
+  struct MeshData {
+    std::string name;
+    // The maps only hold their path, see MaterialMeshModel::attachTexture().
+    Material material;
+    // Point either to the owned vectors or into the mapped mesh cache.
+    const MaterialMeshVertex* vertices = nullptr;
+    size_t numVertices = 0;
+    const unsigned int* indices = nullptr;
+    size_t numIndices = 0;
+    std::vector<MaterialMeshVertex> ownedVertices;
+    std::vector<unsigned int> ownedIndices;
+  };
+
+  // A texture used by the maps of the meshes.
+  struct TextureData {
+    // Relative to baseDir.
+    std::string path;
+    // From the first map using the texture.
+    TextureUsage usage;
+  };
+
+  std::string name;
+  Path baseDir;
+  AABB bounds;
+  // In 1/model unit, see MaterialMeshModel::maxCurvature().
+  float maxCurvature = 0.0f;
+  std::vector<MeshData> meshes;
+  // Without duplicates.
+  std::vector<TextureData> textures;
+  std::unique_ptr<MappedFile> cacheFile;
+  bool fromCache = false;
+};
+
 class MaterialMeshModel : public BaseModel {
 public:
   ~MaterialMeshModel() override { release(); }
 
   const Path& baseDir() const { return m_baseDir; }
   const std::string& name() const { return m_name; }
+  // In model space, computed at load.
+  const AABB& bounds() const { return m_bounds; }
+  // In 1/model unit: the 95th percentile of the curvature along the triangle edges, computed at
+  // load. The sharpest creases are left out, they would take most of the range.
+  float maxCurvature() const { return m_maxCurvature; }
+
+  bool isLoaded() const { return !m_meshes.empty(); }
 
-  // Load a 3D model with Assimp.
-  bool load(const std::string& name, const Path& path);
+  // Read a 3D model from its mesh cache, or with Assimp if the cache is missing or out of date.
+  // The cache is written next to the model, see MeshCacheVersion. Does not use GL.
+  static bool read(const std::string& name, const Path& path, MaterialMeshModelData& outData);
+  // Create the meshes, their maps are enabled as the textures are attached.
+  void upload(const MaterialMeshModelData& data);
+  // Create the texture of the maps using path, see MaterialMeshModelData::textures.
+  void attachTexture(const std::string& path, const EncodedTexture& encoded);
 
   void render(const ShaderProgram& program) const override;
   void renderForGBuf(const ShaderProgram& program) const override;
@@ -28,9 +82,13 @@ public:
   void bindMeshAlbedo(size_t meshIndex, GLuint binding) const;
 
 private:
-  void loadMesh(const aiMesh* mesh, const aiScene* scene);
-  Material loadMaterial(const aiMaterial* mtl);
-  Texture loadTexture(const aiString& path, const std::string& type);
+  static bool readCache(const Path& cachePath, uint64_t key, MaterialMeshModelData& outData);
+  static bool import(const Path& path, unsigned int flags, MaterialMeshModelData& outData,
+                     std::vector<char>& outCache);
+
+  static void loadMesh(const aiMesh* mesh, const aiScene* scene, MaterialMeshModelData& outData,
+                       std::vector<char>& cache);
+  static Material loadMaterial(const aiMaterial* mtl);
 
 private:
   Path m_baseDir = "";
@@ -38,6 +96,8 @@ private:
 
   std::vector<MaterialMesh> m_meshes;
   std::vector<Texture> m_loadedTextures;
+  AABB m_bounds;
+  float m_maxCurvature = 0.0f;
 
   unsigned int m_nbTriangles = 0;
   unsigned int m_nbVertices = 0;
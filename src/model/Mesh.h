@@ -15,6 +15,8 @@ public:
 
   void init(const std::vector<Vertex>& vertices);
   void init(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices);
+  // Uploads straight from memory, e.g. a mapped file.
+  void init(const Vertex* vertices, size_t numVertices, const GLuint* indices, size_t numIndices);
   void release();
 
   void render(const ShaderProgram& program) const override;
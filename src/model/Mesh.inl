@@ -17,18 +17,22 @@ template <typename Vertex> void Mesh<Vertex>::init(const std::vector<Vertex>& ve
 
 template <typename Vertex>
 void Mesh<Vertex>::init(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices) {
+  init(vertices.data(), vertices.size(), indices.data(), indices.size());
+}
+
+template <typename Vertex>
+void Mesh<Vertex>::init(const Vertex* vertices, size_t numVertices, const GLuint* indices,
+                        size_t numIndices) {
   release();
 
   glCreateVertexArrays(1, &m_VA);
   glCreateBuffers(1, &m_VB);
   glCreateBuffers(1, &m_IB);
 
-  m_numVertices = vertices.size();
-  m_numIndices = indices.size();
-  glNamedBufferData(m_VB, (GLsizeiptr)(m_numVertices * sizeof(Vertex)), vertices.data(),
-                    GL_STATIC_DRAW);
-  glNamedBufferData(m_IB, (GLsizeiptr)(m_numIndices * sizeof(GLuint)), indices.data(),
-                    GL_STATIC_DRAW);
+  m_numVertices = numVertices;
+  m_numIndices = numIndices;
+  glNamedBufferData(m_VB, (GLsizeiptr)(m_numVertices * sizeof(Vertex)), vertices, GL_STATIC_DRAW);
+  glNamedBufferData(m_IB, (GLsizeiptr)(m_numIndices * sizeof(GLuint)), indices, GL_STATIC_DRAW);
 
   glVertexArrayVertexBuffer(m_VA, 0, m_VB, 0, sizeof(Vertex));
   glVertexArrayElementBuffer(m_VA, m_IB);
@@ -46,6 +50,8 @@ template <typename Vertex> void Mesh<Vertex>::release() {
     glDeleteBuffers(1, &m_VB);
   if (m_IB)
     glDeleteBuffers(1, &m_IB);
+  m_VA = m_VB = m_IB = 0;
+  m_numVertices = m_numIndices = 0;
 }
 
 template <typename Vertex> void Mesh<Vertex>::render(const ShaderProgram& program) const {
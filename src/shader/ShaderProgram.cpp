@@ -1,17 +1,85 @@
 #include "ShaderProgram.h"
 #include "../utils/ReadFile.h"
 
+#include <algorithm>
+#include <cstring>
 #include <glm/gtc/type_ptr.hpp>
 
 namespace sss {
 
+// The #version directive must come first, so the defines go on the following line.
+static void injectDefines(std::string& source, const std::vector<std::string>& defines) {
+  if (defines.empty())
+    return;
+
+  size_t pos = source.find("#version");
+  pos = pos == std::string::npos ? 0 : source.find('\n', pos);
+  pos = pos == std::string::npos ? source.size() : pos + 1;
+
+  std::string header;
+  for (const std::string& define : defines)
+    header += "#define " + define + "\n";
+  // Keep the line numbers of compile errors matching the file.
+  const size_t versionLines = std::count(source.begin(), source.begin() + (ptrdiff_t)pos, '\n');
+  header += "#line " + std::to_string(versionLines + 1) + "\n";
+
+  source.insert(pos, header);
+}
+
+// Replaces the lines of the form #include "file" with the file, relative to the shaders
+// directory. Included files can include other files but must not have a #version directive.
+static bool resolveIncludes(const std::string& dir, std::string& source, int depth = 0) {
+  constexpr int MaxDepth = 8;
+  constexpr const char* Directive = "#include \"";
+
+  std::string result;
+  size_t lineStart = 0;
+  size_t lineNumber = 1;
+  while (lineStart < source.size()) {
+    size_t lineEnd = source.find('\n', lineStart);
+    lineEnd = lineEnd == std::string::npos ? source.size() : lineEnd + 1;
+    const std::string line = source.substr(lineStart, lineEnd - lineStart);
+    lineStart = lineEnd;
+    ++lineNumber;
+
+    if (line.compare(0, std::strlen(Directive), Directive) != 0) {
+      result += line;
+      continue;
+    }
+
+    const size_t nameStart = std::strlen(Directive);
+    const size_t nameEnd = line.find('"', nameStart);
+    if (nameEnd == std::string::npos || depth >= MaxDepth) {
+      std::cout << "Invalid #include: " << line << std::endl;
+      return false;
+    }
+
+    const std::string file = line.substr(nameStart, nameEnd - nameStart);
+    std::string included;
+    if (!sss::readFile(dir + file, included) || !resolveIncludes(dir, included, depth + 1)) {
+      std::cout << "Failed to include " << file << std::endl;
+      return false;
+    }
+
+    // Keep the line numbers of compile errors matching the files.
+    result += "#line 1\n" + included + "\n#line " + std::to_string(lineNumber) + "\n";
+  }
+
+  source = std::move(result);
+  return true;
+}
+
 void ShaderProgram::init() { m_id = glCreateProgram(); }
 
-bool ShaderProgram::addShader(GLenum type, const std::string& file) {
+bool ShaderProgram::addShader(GLenum type, const std::string& file,
+                              const std::vector<std::string>& defines) {
   std::string source;
-  if (!sss::readFile(s_shadersDir + file, source))
+  if (!sss::readFile(s_shadersDir + file, source) ||
+      !resolveIncludes(s_shadersDir, source))
     return false;
 
+  injectDefines(source, defines);
+
   m_shaders.emplace_back(source.c_str(), type);
   if (!m_shaders.back().compile()) {
     m_shaders.pop_back();
@@ -45,9 +113,20 @@ void ShaderProgram::release() {
 }
 
 bool ShaderProgram::initVertexFragment(const std::string& vertexPath,
-                                       const std::string& fragmentPath) {
+                                       const std::string& fragmentPath,
+                                       const std::vector<std::string>& defines) {
   init();
-  if (!addShader(GL_VERTEX_SHADER, vertexPath) || !addShader(GL_FRAGMENT_SHADER, fragmentPath))
+  if (!addShader(GL_VERTEX_SHADER, vertexPath, defines) ||
+      !addShader(GL_FRAGMENT_SHADER, fragmentPath, defines))
+    return false;
+
+  return link();
+}
+
+bool ShaderProgram::initCompute(const std::string& computePath,
+                                const std::vector<std::string>& defines) {
+  init();
+  if (!addShader(GL_COMPUTE_SHADER, computePath, defines))
     return false;
 
   return link();
@@ -79,6 +158,9 @@ void ShaderProgram::setVec3(GLint loc, const glm::vec3& value) const {
 void ShaderProgram::setVec3(GLint loc, float x, float y, float z) const {
   glProgramUniform3f(m_id, loc, x, y, z);
 }
+void ShaderProgram::setVec3Array(GLint loc, const glm::vec3* values, GLsizei count) const {
+  glProgramUniform3fv(m_id, loc, count, glm::value_ptr(values[0]));
+}
 
 void ShaderProgram::setVec4(GLint loc, const glm::vec4& value) const {
   glProgramUniform4fv(m_id, loc, 1, glm::value_ptr(value));
@@ -20,11 +20,16 @@ public:
   GLuint id() const { return m_id; }
 
   void init();
-  bool addShader(GLenum type, const std::string& file);
+  // #include "file" directives are resolved relative to the shaders directory.
+  bool addShader(GLenum type, const std::string& file,
+                 const std::vector<std::string>& defines = {});
   bool link();
   void release();
 
-  bool initVertexFragment(const std::string& vertexPath, const std::string& fragmentPath);
+  // The defines are injected in both stages, right after the #version directive.
+  bool initVertexFragment(const std::string& vertexPath, const std::string& fragmentPath,
+                          const std::vector<std::string>& defines = {});
+  bool initCompute(const std::string& computePath, const std::vector<std::string>& defines = {});
 
   void use() const;
 
@@ -38,6 +43,7 @@ public:
   void setVec2(GLint loc, float x, float y) const;
   void setVec3(GLint loc, const glm::vec3& value) const;
   void setVec3(GLint loc, float x, float y, float z) const;
+  void setVec3Array(GLint loc, const glm::vec3* values, GLsizei count) const;
   void setVec4(GLint loc, const glm::vec4& value) const;
   void setVec4(GLint loc, float x, float y, float z, float w) const;
   void setMat2(GLint loc, const glm::mat2& mat) const;
@@ -0,0 +1,82 @@
+#include "BurleyKernel.h"
+
+#include <algorithm>
+
+namespace sss {
+
+// Scattering distance of a unit falloff, most of the energy then lies within MaxRadius.
+static constexpr float FalloffToDistance = 0.4f;
+static constexpr int CDFTableSize = 256;
+
+float BurleyKernel::profile(float r, float d) {
+  r = glm::max(r, 1e-6f);
+  return (glm::exp(-r / d) + glm::exp(-r / (3.0f * d))) / (8.0f * Pi * d * r);
+}
+
+float BurleyKernel::pdf(float r, float d) {
+  return (glm::exp(-r / d) + glm::exp(-r / (3.0f * d))) / (4.0f * d);
+}
+
+float BurleyKernel::cdf(float r, float d) {
+  return 1.0f - 0.25f * glm::exp(-r / d) - 0.75f * glm::exp(-r / (3.0f * d));
+}
+
+bool BurleyKernel::update(int nSamples, const Vec3f& falloff, const Vec3f& strength) {
+  nSamples = glm::clamp(nSamples, 2, MaxNumSamples);
+  if (!m_samples.empty() && nSamples == m_nSamples && falloff == m_falloff &&
+      strength == m_strength)
+    return false;
+
+  m_nSamples = nSamples;
+  m_falloff = falloff;
+  m_strength = strength;
+  compute();
+  return true;
+}
+
+void BurleyKernel::compute() {
+  const Vec3f d = glm::max(m_falloff * FalloffToDistance, Vec3f(0.001f));
+  // Sample the widest channel, the others are covered by its denser center.
+  const float dMax = glm::max(d.x, glm::max(d.y, d.z));
+
+  // CDF of the radius truncated to MaxRadius, tabulated so that it can be inverted below.
+  float table[CDFTableSize];
+  const float cdfMax = cdf(MaxRadius, dMax);
+  for (int i = 0; i < CDFTableSize; ++i) {
+    const float r = MaxRadius * (float)i / (float)(CDFTableSize - 1);
+    table[i] = cdf(r, dMax) / cdfMax;
+  }
+
+  std::vector<Vec4f>& kernel = m_samples;
+  kernel.resize(m_nSamples);
+
+  // Stratified radii: the i-th tap covers the [i, i + 1] / nTaps slice of the CDF.
+  const int nTaps = m_nSamples - 1;
+  Vec3f sum = Vec3fZero;
+  for (int i = 0; i < nTaps; ++i) {
+    const float u = ((float)i + 0.5f) / (float)nTaps;
+    const int j = (int)(std::lower_bound(table, table + CDFTableSize, u) - table);
+    const int j0 = glm::max(j - 1, 0);
+    const float t = table[j] > table[j0] ? (u - table[j0]) / (table[j] - table[j0]) : 0.0f;
+    const float r = MaxRadius * ((float)j0 + t) / (float)(CDFTableSize - 1);
+
+    // Monte-Carlo estimate of the integral over the disk, the angle is uniformly distributed.
+    const float p = pdf(r, dMax) / cdfMax;
+    Vec3f w;
+    for (int c = 0; c < 3; ++c)
+      w[c] = profile(r, d[c]) * TwoPi * r / p;
+
+    kernel[i + 1] = Vec4f(w, r);
+    sum += w;
+  }
+
+  // Normalize the weights, then tweak them using the desired strength like the separable kernel:
+  // the center sample is lerp(1.0, 0.0, strength) and the others lerp(0.0, w, strength).
+  kernel[0] = Vec4f(Vec3f(1.0f) - m_strength, 0.0f);
+  for (int i = 1; i < m_nSamples; ++i) {
+    const Vec3f w = Vec3f(kernel[i]) / sum * m_strength;
+    kernel[i] = Vec4f(w, kernel[i].w);
+  }
+}
+
+} // namespace sss
@@ -0,0 +1,51 @@
+#pragma once
+#ifndef SSS_SKIN_BURLEYKERNEL_H
+#define SSS_SKIN_BURLEYKERNEL_H
+
+#include "../MathDefines.h"
+#include "SeparableKernel.h"
+
+#include <vector>
+
+namespace sss {
+
+// Radial kernel sampling Burley's normalized diffusion profile, see
+// https://graphics.pixar.com/library/ApproxBSSRDF/paper.pdf.
+// The radii are importance sampled by inverting a CDF table of the widest channel, each sample
+// stores its RGB weight in xyz and its radius (in [0, MaxRadius]) in w. The center sample comes
+// first, the directions are picked by the shader.
+class BurleyKernel {
+public:
+  // Shares the uniform block layout of SeparableKernel.
+  static constexpr int MaxNumSamples = SeparableKernel::MaxNumSamples;
+  // Same range as the separable kernel offsets.
+  static constexpr float MaxRadius = 3.0f;
+
+  // Recompute the kernel if any of the parameters changed since the last call, the falloff is
+  // used as the per-channel scattering distance.
+  // Returns true if the samples were updated.
+  bool update(int nSamples, const Vec3f& falloff, const Vec3f& strength);
+
+  const std::vector<Vec4f>& samples() const { return m_samples; }
+  int numSamples() const { return m_nSamples; }
+
+  // Diffusion profile R(r) for the shape parameter d (scattering distance), normalized so that
+  // its integral over the plane is 1.
+  static float profile(float r, float d);
+  // Probability density of the radius, r * R(r) * 2pi.
+  static float pdf(float r, float d);
+  static float cdf(float r, float d);
+
+private:
+  void compute();
+
+private:
+  int m_nSamples = 0;
+  Vec3f m_falloff = Vec3fZero;
+  Vec3f m_strength = Vec3fZero;
+  std::vector<Vec4f> m_samples;
+};
+
+} // namespace sss
+
+#endif
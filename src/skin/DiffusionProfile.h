@@ -0,0 +1,42 @@
+#pragma once
+#ifndef SSS_SKIN_DIFFUSIONPROFILE_H
+#define SSS_SKIN_DIFFUSIONPROFILE_H
+
+#include "../MathDefines.h"
+
+namespace sss {
+
+// Sum of gaussians diffusion profile of skin, same as profile() in sss-blur.frag.
+// https://github.com/iryoku/separable-sss/blob/master/Demo/Code/SeparableSSS.cpp#L172
+inline Vec3f gaussian(float variance, float r, const Vec3f& falloff) {
+  Vec3f g;
+  for (int i = 0; i < 3; ++i) {
+    float rr = r / (0.001f + falloff[i]);
+    g[i] = glm::exp((-(rr * rr)) / (2.0f * variance)) / (2.0f * 3.14f * variance);
+  }
+  return g;
+}
+
+// r is in mm.
+inline Vec3f profile(float r, const Vec3f& falloff) {
+  return 0.100f * gaussian(0.0484f, r, falloff) + 0.118f * gaussian(0.187f, r, falloff) +
+         0.113f * gaussian(0.567f, r, falloff) + 0.358f * gaussian(1.99f, r, falloff) +
+         0.078f * gaussian(7.41f, r, falloff);
+}
+
+// Profile of the light transmitted through a slab of scaled thickness d, same as the sum of
+// gaussians that SSSTransmittance() in main.frag used to evaluate per pixel.
+// http://www.iryoku.com/translucency/
+inline Vec3f transmittanceProfile(float d) {
+  float dd = -d * d;
+  return Vec3f(0.233f, 0.455f, 0.649f) * glm::exp(dd / 0.0064f) +
+         Vec3f(0.1f, 0.336f, 0.344f) * glm::exp(dd / 0.0484f) +
+         Vec3f(0.118f, 0.198f, 0.0f) * glm::exp(dd / 0.187f) +
+         Vec3f(0.113f, 0.007f, 0.007f) * glm::exp(dd / 0.567f) +
+         Vec3f(0.358f, 0.004f, 0.0f) * glm::exp(dd / 1.99f) +
+         Vec3f(0.078f, 0.0f, 0.0f) * glm::exp(dd / 7.41f);
+}
+
+} // namespace sss
+
+#endif
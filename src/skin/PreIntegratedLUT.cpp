@@ -0,0 +1,80 @@
+#include "PreIntegratedLUT.h"
+#include "../utils/FileCache.h"
+#include "../utils/ThreadPool.h"
+#include "DiffusionProfile.h"
+
+#include <cstring>
+
+namespace sss {
+
+// Bump when the integration changes, to invalidate the cached tables.
+static constexpr uint32_t LUTVersion = 1;
+static constexpr int NumIntegrationSteps = 512;
+
+bool PreIntegratedLUT::update(const Vec3f& falloff, float maxCurvature, ThreadPool& pool,
+                              const FileCache* cache, const std::function<bool()>& isCancelled) {
+  m_falloff = falloff;
+  m_maxCurvature = maxCurvature;
+
+  uint64_t key = fnv1a(LUTVersion);
+  key = fnv1a(Size, key);
+  key = fnv1a(maxCurvature, key);
+  key = fnv1a(falloff, key);
+
+  const size_t byteSize = (size_t)Size * Size * sizeof(Vec3f);
+  std::vector<char> data;
+  if (cache && cache->load("pre-integrated-lut", key, data) && data.size() == byteSize) {
+    m_texels.resize((size_t)Size * Size);
+    std::memcpy(m_texels.data(), data.data(), byteSize);
+    return true;
+  }
+
+  if (!integrate(pool, isCancelled))
+    return false;
+  if (cache)
+    cache->store("pre-integrated-lut", key, m_texels.data(), byteSize);
+  return false;
+}
+
+bool PreIntegratedLUT::integrate(ThreadPool& pool, const std::function<bool()>& isCancelled) {
+  m_texels.resize((size_t)Size * Size);
+
+  // One row (curvature) per task.
+  pool.parallelFor(0, Size, [this, &isCancelled](int y) {
+    if (isCancelled && isCancelled())
+      return;
+
+    const float curvature = m_maxCurvature * (float)y / (float)(Size - 1);
+    for (int x = 0; x < Size; ++x) {
+      const float NdotL = 2.0f * (float)x / (float)(Size - 1) - 1.0f;
+      m_texels[(size_t)y * Size + x] = integrateTexel(NdotL, curvature, m_falloff);
+    }
+  });
+  return !(isCancelled && isCancelled());
+}
+
+Vec3f PreIntegratedLUT::integrateTexel(float NdotL, float curvature, const Vec3f& falloff) {
+  // A flat surface does not scatter light around, only the incident lighting remains.
+  if (curvature <= 0.0f)
+    return Vec3f(glm::max(NdotL, 0.0f));
+
+  const float theta = glm::acos(glm::clamp(NdotL, -1.0f, 1.0f));
+  const float radius = 1.0f / curvature;
+
+  // Light received by the points of the ring, weighted by their distance to the shaded point.
+  Vec3f totalWeights = Vec3fZero;
+  Vec3f totalLight = Vec3fZero;
+  const float dx = TwoPi / (float)NumIntegrationSteps;
+  for (int i = 0; i < NumIntegrationSteps; ++i) {
+    const float x = -Pi + ((float)i + 0.5f) * dx;
+    const float distance = glm::abs(2.0f * radius * glm::sin(x * 0.5f));
+    const Vec3f weights = profile(distance, falloff);
+
+    totalWeights += weights;
+    totalLight += weights * glm::max(glm::cos(theta + x), 0.0f);
+  }
+
+  return totalLight / totalWeights;
+}
+
+} // namespace sss
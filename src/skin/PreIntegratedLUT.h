@@ -0,0 +1,49 @@
+#pragma once
+#ifndef SSS_SKIN_PREINTEGRATEDLUT_H
+#define SSS_SKIN_PREINTEGRATEDLUT_H
+
+#include "../MathDefines.h"
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace sss {
+
+class FileCache;
+class ThreadPool;
+
+// Pre-integrated skin diffusion (Penner, GPU Pro 2): the diffuse lighting of a ring of radius
+// 1/curvature lit at N.L, scattered with the profile of sss-blur.frag.
+// Texels are indexed by N.L remapped to [0, 1] in x and curvature / maxCurvature() in y.
+class PreIntegratedLUT {
+public:
+  static constexpr int Size = 128;
+  // In 1/mm, a 1mm radius. Used until the range is fitted to a model.
+  static constexpr float DefaultMaxCurvature = 1.0f;
+
+  // Loads the table from cache when given, or integrates it and stores it there.
+  // Returns true if the table was loaded from the cache. The integration stops between rows once
+  // isCancelled returns true, the table is then incomplete and not stored.
+  bool update(const Vec3f& falloff, float maxCurvature, ThreadPool& pool,
+              const FileCache* cache = nullptr, const std::function<bool()>& isCancelled = {});
+
+  const std::vector<Vec3f>& texels() const { return m_texels; }
+  const Vec3f& falloff() const { return m_falloff; }
+  float maxCurvature() const { return m_maxCurvature; }
+  bool isValid() const { return !m_texels.empty(); }
+
+private:
+  // False if cancelled.
+  bool integrate(ThreadPool& pool, const std::function<bool()>& isCancelled);
+  static Vec3f integrateTexel(float NdotL, float curvature, const Vec3f& falloff);
+
+private:
+  Vec3f m_falloff = Vec3fZero;
+  float m_maxCurvature = DefaultMaxCurvature;
+  std::vector<Vec3f> m_texels;
+};
+
+} // namespace sss
+
+#endif
@@ -0,0 +1,79 @@
+#include "SeparableKernel.h"
+#include "DiffusionProfile.h"
+
+namespace sss {
+
+bool SeparableKernel::update(int nSamples, const Vec3f& falloff, const Vec3f& strength) {
+  nSamples = glm::clamp(nSamples, 2, MaxNumSamples);
+  if (!m_samples.empty() && nSamples == m_nSamples && falloff == m_falloff &&
+      strength == m_strength)
+    return false;
+
+  m_nSamples = nSamples;
+  m_falloff = falloff;
+  m_strength = strength;
+  compute();
+  return true;
+}
+
+void SeparableKernel::compute() {
+  const int n = m_nSamples;
+  const float range = n > 20 ? 3.0f : 2.0f;
+  const float exponent = 2.0f;
+
+  std::vector<Vec4f>& kernel = m_samples;
+  kernel.resize(n);
+
+  // Calculate the offsets:
+  float step = 2.0f * range / (float)(n - 1);
+  for (int i = 0; i < n; ++i) {
+    float o = -range + (float)i * step;
+    float sign = o < 0.0f ? -1.0f : 1.0f;
+    kernel[i].w = range * sign * glm::abs(glm::pow(o, exponent)) / glm::pow(range, exponent);
+  }
+
+  // Calculate the weights:
+  for (int i = 0; i < n; ++i) {
+    float w0 = i > 0 ? glm::abs(kernel[i].w - kernel[i - 1].w) : 0.0f;
+    float w1 = i < n - 1 ? glm::abs(kernel[i].w - kernel[i + 1].w) : 0.0f;
+    float area = (w0 + w1) / 2.0f;
+    Vec3f t = area * profile(kernel[i].w, m_falloff);
+    kernel[i].x = t.x;
+    kernel[i].y = t.y;
+    kernel[i].z = t.z;
+  }
+
+  // We want the offset 0.0 to come first:
+  Vec4f t = kernel[n / 2];
+  for (int i = n / 2; i > 0; --i)
+    kernel[i] = kernel[i - 1];
+  kernel[0] = t;
+
+  // Calculate the sum of the weights, we will need to normalize them below:
+  Vec3f sum = Vec3fZero;
+  for (int i = 0; i < n; ++i)
+    sum += Vec3f(kernel[i]);
+
+  // Normalize the weights:
+  for (int i = 0; i < n; ++i) {
+    kernel[i].x /= sum.x;
+    kernel[i].y /= sum.y;
+    kernel[i].z /= sum.z;
+  }
+
+  // Tweak them using the desired strength. The first one is:
+  // lerp(1.0, kernel[0].rgb, strength)
+  kernel[0].x = (1.0f - m_strength.x) * 1.0f + m_strength.x * kernel[0].x;
+  kernel[0].y = (1.0f - m_strength.y) * 1.0f + m_strength.y * kernel[0].y;
+  kernel[0].z = (1.0f - m_strength.z) * 1.0f + m_strength.z * kernel[0].z;
+
+  // The others:
+  // lerp(0.0, kernel[0].rgb, strength)
+  for (int i = 1; i < n; ++i) {
+    kernel[i].x *= m_strength.x;
+    kernel[i].y *= m_strength.y;
+    kernel[i].z *= m_strength.z;
+  }
+}
+
+} // namespace sss
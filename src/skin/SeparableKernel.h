@@ -0,0 +1,38 @@
+#pragma once
+#ifndef SSS_SKIN_SEPARABLEKERNEL_H
+#define SSS_SKIN_SEPARABLEKERNEL_H
+
+#include "../MathDefines.h"
+
+#include <vector>
+
+namespace sss {
+
+// Separable SSS kernel, see http://www.iryoku.com/separable-sss/.
+// Each sample stores its RGB weight in xyz and its offset (in [-range, range]) in w, the center
+// sample comes first.
+class SeparableKernel {
+public:
+  // Must match MAX_NUM_SAMPLES in sss-blur.frag.
+  static constexpr int MaxNumSamples = 50;
+
+  // Recompute the kernel if any of the parameters changed since the last call.
+  // Returns true if the samples were updated.
+  bool update(int nSamples, const Vec3f& falloff, const Vec3f& strength);
+
+  const std::vector<Vec4f>& samples() const { return m_samples; }
+  int numSamples() const { return m_nSamples; }
+
+private:
+  void compute();
+
+private:
+  int m_nSamples = 0;
+  Vec3f m_falloff = Vec3fZero;
+  Vec3f m_strength = Vec3fZero;
+  std::vector<Vec4f> m_samples;
+};
+
+} // namespace sss
+
+#endif
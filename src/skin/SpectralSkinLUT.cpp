@@ -0,0 +1,212 @@
+#include "SpectralSkinLUT.h"
+#include "../Absorption.h"
+#include "../utils/Image.h"
+#include "../utils/ThreadPool.h"
+
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SSS_SPECTRAL_SSE
+#include <emmintrin.h>
+#endif
+
+namespace sss {
+
+static_assert(SpectralSkinLUT::NumWavelengths % 4 == 0, "The SSE path evaluates 4 wavelengths");
+
+// Same constants as skin-albedo.comp.
+static constexpr float SkinDepth = 0.0003f;
+static constexpr float Ln10 = 2.302585f;
+
+static float decodeCoefficient(const unsigned char* rgb) {
+  return (float)((int)rgb[2] << 16 | (int)rgb[1] << 8 | (int)rgb[0]);
+}
+
+bool SpectralSkinLUT::loadCoefficients(const std::string& path) {
+  RGBImage image;
+  if (!image.load(path, 3))
+    return false;
+
+  const int lastColumn = 5 * (NumWavelengths - 1);
+  if (image.height() < 4 || image.width() <= lastColumn) {
+    std::cout << "Unexpected size of the absorption coefficients \"" << path << "\"" << std::endl;
+    return false;
+  }
+
+  const unsigned char* pixels = image.pixels();
+  const auto texel = [&](int x, int row) {
+    return decodeCoefficient(pixels + 3 * ((size_t)row * image.width() + x));
+  };
+
+  for (int i = 0; i < NumWavelengths; ++i) {
+    const float lambda = 380.0f + 10.0f * (float)i;
+    const int x = (int)(lambda - 380.0f) / 2;
+    m_lambda[i] = lambda;
+    m_fat[i] = texel(x, 0);
+    m_water[i] = texel(x, 1);
+    m_deoxy[i] = 2.303f * texel(x, 2) / 64500.0f;
+    m_oxy[i] = 2.303f * texel(x, 3) / 64500.0f;
+    m_melanosome[i] = -362.0f * std::log(1.0f + (lambda - 380.0f) * 0.5f) + 2000.0f;
+  }
+
+  m_F = m_W = -1.0f;
+  return true;
+}
+
+bool SpectralSkinLUT::build(float F, float W, ThreadPool& pool, bool useSIMD,
+                            const std::function<bool()>& isCancelled) {
+  m_F = F;
+  m_W = W;
+  for (int i = 0; i < NumWavelengths; ++i)
+    m_fatWater[i] = W * m_water[i] / 100.0f + F * m_fat[i] / 100.0f;
+
+  m_texels.resize((size_t)Size * Size * Size);
+
+  // One row (B) per task.
+  pool.parallelFor(0, Size * Size, [this, useSIMD, &isCancelled](int row) {
+    if (isCancelled && isCancelled())
+      return;
+
+    const float step = MaxConcentration / (float)(Size - 1);
+    const float S = step * (float)(row % Size);
+    const float M = step * (float)(row / Size);
+    Vec3f* texels = m_texels.data() + (size_t)row * Size;
+    for (int x = 0; x < Size; ++x) {
+      const float u = (float)x / (float)(Size - 1);
+      const float B = MaxConcentration * u * u;
+      texels[x] = useSIMD ? evaluateSIMD(B, S, M) : evaluateScalar(B, S, M);
+    }
+  });
+  return !(isCancelled && isCancelled());
+}
+
+Vec3f SpectralSkinLUT::textureCoord(float B, float S, float M) {
+  Vec3f t = glm::clamp(Vec3f(B, S, M) / MaxConcentration, 0.0f, 1.0f);
+  t.x = std::sqrt(t.x);
+  // The texels are evaluated at i / (Size - 1).
+  return (t * (float)(Size - 1) + 0.5f) / (float)Size;
+}
+
+Vec3f SpectralSkinLUT::sample(float B, float S, float M) const {
+  const Vec3f p = textureCoord(B, S, M) * (float)Size - 0.5f;
+  const Vec3i p0 = glm::min(Vec3i(p), Vec3i(Size - 2));
+  const Vec3f f = p - Vec3f(p0);
+
+  Vec3f result = Vec3fZero;
+  for (int z = 0; z < 2; ++z) {
+    for (int y = 0; y < 2; ++y) {
+      for (int x = 0; x < 2; ++x) {
+        const float w = (x ? f.x : 1.0f - f.x) * (y ? f.y : 1.0f - f.y) * (z ? f.z : 1.0f - f.z);
+        const size_t i = ((size_t)(p0.z + z) * Size + (size_t)(p0.y + y)) * Size + (p0.x + x);
+        result += w * m_texels[i];
+      }
+    }
+  }
+  return result;
+}
+
+Vec3f SpectralSkinLUT::evaluateScalar(float B, float S, float M) const {
+  Vec3f albedo = Vec3fZero;
+  for (int i = 0; i < NumWavelengths; ++i) {
+    const float mu = B * S * m_oxy[i] * B + B * (1.0f - S) * m_deoxy[i] * B + m_fatWater[i] +
+                     M * m_melanosome[i];
+    const float A = SkinDepth * mu / 2.303f; // absorbance
+    const float T = std::exp(-A * Ln10);     // transmittance
+    const float R = (1.0f - (A + T)) * 400.0f + 688.0f;
+    albedo += Vec3f(1.0f) - absorb(Vec3f(1.0f), R);
+  }
+  return albedo / (float)NumWavelengths;
+}
+
+#ifdef SSS_SPECTRAL_SSE
+namespace {
+
+// exp(x) = 2^n * 2^f with n the nearest integer of x / ln(2), the polynomial of 2^f on
+// [-0.5, 0.5] is accurate to ~3e-6.
+__m128 exp_ps(__m128 x) {
+  x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-87.0f)), _mm_set1_ps(88.0f));
+  const __m128 t = _mm_mul_ps(x, _mm_set1_ps(1.442695f));
+  const __m128i n = _mm_cvtps_epi32(t);
+  const __m128 f = _mm_sub_ps(t, _mm_cvtepi32_ps(n));
+
+  __m128 p = _mm_set1_ps(1.333356e-3f);
+  p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(9.618129e-3f));
+  p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(5.550411e-2f));
+  p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(0.2402265f));
+  p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(0.6931472f));
+  p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(1.0f));
+
+  const __m128i e = _mm_slli_epi32(_mm_add_epi32(n, _mm_set1_epi32(127)), 23);
+  return _mm_mul_ps(p, _mm_castsi128_ps(e));
+}
+
+// Intervals of absorb() in Absorption.h, each channel being a + b * wavelength.
+struct AbsorbInterval {
+  float begin, end;
+  float a[3], b[3];
+};
+
+constexpr AbsorbInterval AbsorbIntervals[] = {
+  {380.0f, 410.0f, {0.6f - 0.41f * 410.0f / 30.0f, 0.0f, 0.39f + 0.6f * 410.0f / 30.0f},
+   {0.41f / 30.0f, 0.0f, -0.6f / 30.0f}},
+  {410.0f, 440.0f, {0.19f - 0.19f * 440.0f / 30.0f, 0.0f, 1.0f}, {0.19f / 30.0f, 0.0f, 0.0f}},
+  {440.0f, 490.0f, {0.0f, 1.0f - 490.0f / 50.0f, 1.0f}, {0.0f, 1.0f / 50.0f, 0.0f}},
+  {490.0f, 510.0f, {0.0f, 1.0f, 510.0f / 20.0f}, {0.0f, 0.0f, -1.0f / 20.0f}},
+  {510.0f, 580.0f, {1.0f - 580.0f / 70.0f, 1.0f, 0.0f}, {1.0f / 70.0f, 0.0f, 0.0f}},
+  {580.0f, 640.0f, {1.0f, 640.0f / 60.0f, 0.0f}, {0.0f, -1.0f / 60.0f, 0.0f}},
+  {640.0f, 700.0f, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f}},
+  {700.0f, 780.0f, {0.35f - 0.65f * 780.0f / 80.0f, 0.0f, 0.0f}, {0.65f / 80.0f, 0.0f, 0.0f}},
+};
+
+float horizontalSum(__m128 v) {
+  alignas(16) float lanes[4];
+  _mm_store_ps(lanes, v);
+  return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+} // namespace
+#endif
+
+Vec3f SpectralSkinLUT::evaluateSIMD(float B, float S, float M) const {
+#ifdef SSS_SPECTRAL_SSE
+  const __m128 oxyScale = _mm_set1_ps(B * S * B);
+  const __m128 deoxyScale = _mm_set1_ps(B * (1.0f - S) * B);
+  const __m128 melanosomeScale = _mm_set1_ps(M);
+  const __m128 one = _mm_set1_ps(1.0f);
+
+  __m128 sum[3] = {_mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps()};
+  for (int i = 0; i < NumWavelengths; i += 4) {
+    __m128 mu = _mm_mul_ps(oxyScale, _mm_load_ps(m_oxy + i));
+    mu = _mm_add_ps(mu, _mm_mul_ps(deoxyScale, _mm_load_ps(m_deoxy + i)));
+    mu = _mm_add_ps(mu, _mm_load_ps(m_fatWater + i));
+    mu = _mm_add_ps(mu, _mm_mul_ps(melanosomeScale, _mm_load_ps(m_melanosome + i)));
+
+    const __m128 A = _mm_mul_ps(mu, _mm_set1_ps(SkinDepth / 2.303f));
+    const __m128 T = exp_ps(_mm_mul_ps(A, _mm_set1_ps(-Ln10)));
+    const __m128 R = _mm_add_ps(
+      _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(A, T)), _mm_set1_ps(400.0f)), _mm_set1_ps(688.0f));
+
+    // Outside of the intervals absorb() keeps the color, the albedo gets nothing.
+    __m128 absorbed[3] = {one, one, one};
+    for (const AbsorbInterval& interval : AbsorbIntervals) {
+      const __m128 inside = _mm_and_ps(_mm_cmpge_ps(R, _mm_set1_ps(interval.begin)),
+                                       _mm_cmplt_ps(R, _mm_set1_ps(interval.end)));
+      for (int c = 0; c < 3; ++c) {
+        const __m128 value =
+          _mm_add_ps(_mm_set1_ps(interval.a[c]), _mm_mul_ps(_mm_set1_ps(interval.b[c]), R));
+        absorbed[c] = _mm_or_ps(_mm_and_ps(inside, value), _mm_andnot_ps(inside, absorbed[c]));
+      }
+    }
+
+    for (int c = 0; c < 3; ++c)
+      sum[c] = _mm_add_ps(sum[c], _mm_sub_ps(one, absorbed[c]));
+  }
+
+  return Vec3f(horizontalSum(sum[0]), horizontalSum(sum[1]), horizontalSum(sum[2])) /
+         (float)NumWavelengths;
+#else
+  return evaluateScalar(B, S, M);
+#endif
+}
+
+} // namespace sss
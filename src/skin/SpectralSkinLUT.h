@@ -0,0 +1,69 @@
+#pragma once
+#ifndef SSS_SKIN_SPECTRALSKINLUT_H
+#define SSS_SKIN_SPECTRALSKINLUT_H
+
+#include "../MathDefines.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace sss {
+
+class ThreadPool;
+
+// CPU version of the spectral skin model of skin-albedo.comp: the albedo averaged over
+// NumWavelengths wavelengths, tabulated over blood (B), oxygenation (S) and melanosomes (M).
+// Fat and water are fixed per table. Texels are indexed by concentration / MaxConcentration,
+// with B varying fastest. The absorption is quadratic in B and the skin tones lie in the first
+// percents of its range, so the B axis is indexed by sqrt(B / MaxConcentration) instead.
+class SpectralSkinLUT {
+public:
+  static constexpr int Size = 32;
+  // Range of the UI sliders.
+  static constexpr float MaxConcentration = 100.0f;
+  static constexpr int NumWavelengths = 40;
+
+  // Reads the absorption coefficients of fat, water, deoxy and oxy-haemoglobin, one row each
+  // with one texel per 2nm starting at 380nm. 24-bit integers stored in the RGB channels.
+  bool loadCoefficients(const std::string& path);
+
+  // Evaluates 4 wavelengths at once with SSE when available. The scalar path is kept for other
+  // architectures and for comparing timings. Stops between rows once isCancelled returns true,
+  // returns false and leaves the table incomplete then.
+  bool build(float F, float W, ThreadPool& pool, bool useSIMD = true,
+             const std::function<bool()>& isCancelled = {});
+
+  // Normalized coordinates of the concentrations, on the texel centres.
+  static Vec3f textureCoord(float B, float S, float M);
+  // Trilinear lookup, as the GPU samples the table.
+  Vec3f sample(float B, float S, float M) const;
+
+  const std::vector<Vec3f>& texels() const { return m_texels; }
+  float F() const { return m_F; }
+  float W() const { return m_W; }
+  bool isValid() const { return !m_texels.empty(); }
+
+private:
+  Vec3f evaluateScalar(float B, float S, float M) const;
+  Vec3f evaluateSIMD(float B, float S, float M) const;
+
+private:
+  // Per wavelength terms of the absorption coefficient that do not depend on the texel.
+  alignas(16) float m_lambda[NumWavelengths] = {};
+  alignas(16) float m_oxy[NumWavelengths] = {};
+  alignas(16) float m_deoxy[NumWavelengths] = {};
+  alignas(16) float m_melanosome[NumWavelengths] = {};
+  // Fat and water, updated by build().
+  alignas(16) float m_fatWater[NumWavelengths] = {};
+  float m_fat[NumWavelengths] = {};
+  float m_water[NumWavelengths] = {};
+
+  float m_F = -1.0f;
+  float m_W = -1.0f;
+  std::vector<Vec3f> m_texels;
+};
+
+} // namespace sss
+
+#endif
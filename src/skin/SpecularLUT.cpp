@@ -0,0 +1,35 @@
+#include "SpecularLUT.h"
+
+namespace sss {
+
+static float beckmann(float NdotH, float m) {
+  if (NdotH <= 0.0f)
+    return 0.0f;
+
+  const float cos2 = NdotH * NdotH;
+  const float tan2 = (1.0f - cos2) / cos2;
+  const float m2 = m * m;
+  return glm::exp(-tan2 / m2) / (m2 * cos2 * cos2);
+}
+
+static float fresnelSchlick(float VdotH, float F0) {
+  const float base = 1.0f - VdotH;
+  const float exponential = base * base * base * base * base;
+  return exponential + F0 * (1.0f - exponential);
+}
+
+void SpecularLUT::compute(float roughness) {
+  m_roughness = roughness;
+  m_texels.resize((size_t)Size * Size);
+  for (int y = 0; y < Size; ++y) {
+    const float VdotH = (float)y / (float)(Size - 1);
+    const float F = fresnelSchlick(VdotH, F0);
+    for (int x = 0; x < Size; ++x) {
+      const float NdotH = (float)x / (float)(Size - 1);
+      const float D = 0.5f * glm::pow(beckmann(NdotH, roughness), 0.1f);
+      m_texels[(size_t)y * Size + x] = Vec2f(D, F);
+    }
+  }
+}
+
+} // namespace sss
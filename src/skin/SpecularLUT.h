@@ -0,0 +1,33 @@
+#pragma once
+#ifndef SSS_SKIN_SPECULARLUT_H
+#define SSS_SKIN_SPECULARLUT_H
+
+#include "../MathDefines.h"
+
+#include <vector>
+
+namespace sss {
+
+// Terms of the Kelemen/Szirmay-Kalos skin specular (d'Eon and Luebke, GPU Gems 3, chapter 14)
+// for a given roughness. Texels are indexed by N.H in x and V.H in y, so that main.frag gets
+// both with a single fetch:
+// - r: the Beckmann distribution of N.H, stored as 0.5 * D^0.1 to fit in [0, 1].
+// - g: the Schlick Fresnel reflectance of V.H, for the index of refraction of skin.
+class SpecularLUT {
+public:
+  static constexpr int Size = 128;
+  static constexpr float F0 = 0.028f;
+
+  void compute(float roughness);
+
+  const std::vector<Vec2f>& texels() const { return m_texels; }
+  float roughness() const { return m_roughness; }
+
+private:
+  float m_roughness = -1.0f;
+  std::vector<Vec2f> m_texels;
+};
+
+} // namespace sss
+
+#endif
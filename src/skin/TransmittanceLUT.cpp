@@ -0,0 +1,12 @@
+#include "TransmittanceLUT.h"
+#include "DiffusionProfile.h"
+
+namespace sss {
+
+void TransmittanceLUT::compute() {
+  m_texels.resize(Size);
+  for (int i = 0; i < Size; ++i)
+    m_texels[i] = transmittanceProfile(MaxThickness * (float)i / (float)(Size - 1));
+}
+
+} // namespace sss
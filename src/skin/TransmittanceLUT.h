@@ -0,0 +1,28 @@
+#pragma once
+#ifndef SSS_SKIN_TRANSMITTANCELUT_H
+#define SSS_SKIN_TRANSMITTANCELUT_H
+
+#include "../MathDefines.h"
+
+#include <vector>
+
+namespace sss {
+
+// Transmittance profile tabulated over the scaled thickness, see transmittanceProfile().
+// Texels are indexed by thickness / MaxThickness, the profile is ~0 past MaxThickness.
+class TransmittanceLUT {
+public:
+  static constexpr int Size = 256;
+  static constexpr float MaxThickness = 8.0f;
+
+  void compute();
+
+  const std::vector<Vec3f>& texels() const { return m_texels; }
+
+private:
+  std::vector<Vec3f> m_texels;
+};
+
+} // namespace sss
+
+#endif
@@ -0,0 +1,264 @@
+#include "BlockCompression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace sss {
+
+namespace {
+
+constexpr int BC7Weights4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+// Writes bits from the least significant one, as the block formats are defined.
+class BitWriter {
+public:
+  explicit BitWriter(unsigned char* out)
+    : m_out(out) {}
+
+  void write(uint32_t value, int numBits) {
+    for (int i = 0; i < numBits; ++i, ++m_pos) {
+      if (value & (1u << i))
+        m_out[m_pos >> 3] |= (unsigned char)(1u << (m_pos & 7));
+    }
+  }
+
+private:
+  unsigned char* m_out;
+  int m_pos = 0;
+};
+
+struct Mode6Endpoints {
+  int q[2][4]; // 7-bit values.
+  int p[2];    // Shared bits.
+
+  int value(int e, int c) const { return (q[e][c] << 1) | p[e]; }
+};
+
+// Quantizes two float endpoints with the given shared bits.
+Mode6Endpoints quantizeMode6(const float e0[4], const float e1[4], int p0, int p1) {
+  Mode6Endpoints ep;
+  ep.p[0] = p0;
+  ep.p[1] = p1;
+  for (int c = 0; c < 4; ++c) {
+    ep.q[0][c] = std::clamp((int)std::lround((e0[c] - (float)p0) * 0.5f), 0, 127);
+    ep.q[1][c] = std::clamp((int)std::lround((e1[c] - (float)p1) * 0.5f), 0, 127);
+  }
+  return ep;
+}
+
+// Picks the closest weight of every pixel, returns the squared error of the block.
+int selectMode6Indices(const unsigned char rgba[64], const Mode6Endpoints& ep, int outIndices[16]) {
+  int palette[16][4];
+  for (int i = 0; i < 16; ++i) {
+    for (int c = 0; c < 4; ++c)
+      palette[i][c] = ((64 - BC7Weights4[i]) * ep.value(0, c) + BC7Weights4[i] * ep.value(1, c) +
+                       32) >>
+                      6;
+  }
+
+  float dir[4];
+  float dirLen2 = 0.0f;
+  for (int c = 0; c < 4; ++c) {
+    dir[c] = (float)(palette[15][c] - palette[0][c]);
+    dirLen2 += dir[c] * dir[c];
+  }
+
+  int error = 0;
+  for (int px = 0; px < 16; ++px) {
+    const unsigned char* x = rgba + 4 * px;
+
+    // Project on the segment, then only check the neighbouring weights.
+    int guess = 0;
+    if (dirLen2 > 0.0f) {
+      float t = 0.0f;
+      for (int c = 0; c < 4; ++c)
+        t += ((float)x[c] - (float)palette[0][c]) * dir[c];
+      guess = std::clamp((int)std::lround(t / dirLen2 * 15.0f), 0, 15);
+    }
+
+    int best = guess;
+    int bestError = INT32_MAX;
+    for (int i = std::max(guess - 1, 0); i <= std::min(guess + 1, 15); ++i) {
+      int e = 0;
+      for (int c = 0; c < 4; ++c) {
+        const int d = (int)x[c] - palette[i][c];
+        e += d * d;
+      }
+      if (e < bestError) {
+        bestError = e;
+        best = i;
+      }
+    }
+
+    outIndices[px] = best;
+    error += bestError;
+  }
+  return error;
+}
+
+// Tries the four combinations of shared bits, keeps the best one.
+int fitMode6(const unsigned char rgba[64], const float e0[4], const float e1[4],
+             Mode6Endpoints& outEndpoints, int outIndices[16]) {
+  int bestError = INT32_MAX;
+  for (int p = 0; p < 4; ++p) {
+    const Mode6Endpoints ep = quantizeMode6(e0, e1, p & 1, p >> 1);
+    int indices[16];
+    const int error = selectMode6Indices(rgba, ep, indices);
+    if (error < bestError) {
+      bestError = error;
+      outEndpoints = ep;
+      std::memcpy(outIndices, indices, sizeof(indices));
+    }
+  }
+  return bestError;
+}
+
+} // namespace
+
+void encodeBC4Block(const unsigned char pixels[16], unsigned char outBlock[BC4BlockSize]) {
+  const int lo = *std::min_element(pixels, pixels + 16);
+  const int hi = *std::max_element(pixels, pixels + 16);
+
+  std::memset(outBlock, 0, BC4BlockSize);
+  // red0 > red1 selects the 8 value mode, a flat block keeps all the indices at 0.
+  outBlock[0] = (unsigned char)hi;
+  outBlock[1] = (unsigned char)lo;
+  if (hi == lo)
+    return;
+
+  BitWriter writer(outBlock + 2);
+  for (int i = 0; i < 16; ++i) {
+    // Step from red0 (0) to red1 (7), indices 2 to 7 are the interpolated values.
+    const int step = (int)std::lround((float)(hi - pixels[i]) * 7.0f / (float)(hi - lo));
+    const int index = step == 0 ? 0 : step == 7 ? 1 : step + 1;
+    writer.write((uint32_t)index, 3);
+  }
+}
+
+void encodeBC7Mode6Block(const unsigned char rgba[64], unsigned char outBlock[BC7BlockSize]) {
+  // Endpoints on the principal axis of the colors.
+  float mean[4] = {};
+  for (int px = 0; px < 16; ++px) {
+    for (int c = 0; c < 4; ++c)
+      mean[c] += (float)rgba[4 * px + c] * (1.0f / 16.0f);
+  }
+
+  float cov[4][4] = {};
+  for (int px = 0; px < 16; ++px) {
+    float d[4];
+    for (int c = 0; c < 4; ++c)
+      d[c] = (float)rgba[4 * px + c] - mean[c];
+    for (int i = 0; i < 4; ++i) {
+      for (int j = 0; j < 4; ++j)
+        cov[i][j] += d[i] * d[j];
+    }
+  }
+
+  // Power iteration seeded from the channel of largest variance, its first step gives that column
+  // of cov. A fixed seed like (1, 1, 1, 1) is orthogonal to axes like (1, -1, 0, 0) and collapses.
+  int maxChannel = 0;
+  for (int c = 1; c < 4; ++c) {
+    if (cov[c][c] > cov[maxChannel][maxChannel])
+      maxChannel = c;
+  }
+  float axis[4] = {};
+  axis[maxChannel] = 1.0f;
+  for (int iter = 0; iter < 8; ++iter) {
+    float next[4] = {};
+    for (int i = 0; i < 4; ++i) {
+      for (int j = 0; j < 4; ++j)
+        next[i] += cov[i][j] * axis[j];
+    }
+    const float len = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2] +
+                                next[3] * next[3]);
+    if (len < 1e-6f) {
+      // Degenerate, keep the channel axis.
+      std::fill(axis, axis + 4, 0.0f);
+      axis[maxChannel] = 1.0f;
+      break;
+    }
+    for (int c = 0; c < 4; ++c)
+      axis[c] = next[c] / len;
+  }
+
+  float tMin = 0.0f;
+  float tMax = 0.0f;
+  for (int px = 0; px < 16; ++px) {
+    float t = 0.0f;
+    for (int c = 0; c < 4; ++c)
+      t += ((float)rgba[4 * px + c] - mean[c]) * axis[c];
+    tMin = std::min(tMin, t);
+    tMax = std::max(tMax, t);
+  }
+
+  float e0[4];
+  float e1[4];
+  for (int c = 0; c < 4; ++c) {
+    e0[c] = std::clamp(mean[c] + tMin * axis[c], 0.0f, 255.0f);
+    e1[c] = std::clamp(mean[c] + tMax * axis[c], 0.0f, 255.0f);
+  }
+
+  Mode6Endpoints ep;
+  int indices[16];
+  int error = fitMode6(rgba, e0, e1, ep, indices);
+
+  // One least squares refinement of the endpoints for the selected weights.
+  if (error > 0) {
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    float ax[4] = {}, bx[4] = {};
+    for (int px = 0; px < 16; ++px) {
+      const float w = (float)BC7Weights4[indices[px]] / 64.0f;
+      const float a = 1.0f - w;
+      aa += a * a;
+      ab += a * w;
+      bb += w * w;
+      for (int c = 0; c < 4; ++c) {
+        ax[c] += a * (float)rgba[4 * px + c];
+        bx[c] += w * (float)rgba[4 * px + c];
+      }
+    }
+
+    const float det = aa * bb - ab * ab;
+    if (std::abs(det) > 1e-6f) {
+      float r0[4];
+      float r1[4];
+      for (int c = 0; c < 4; ++c) {
+        r0[c] = std::clamp((bb * ax[c] - ab * bx[c]) / det, 0.0f, 255.0f);
+        r1[c] = std::clamp((aa * bx[c] - ab * ax[c]) / det, 0.0f, 255.0f);
+      }
+
+      Mode6Endpoints refined;
+      int refinedIndices[16];
+      if (fitMode6(rgba, r0, r1, refined, refinedIndices) < error) {
+        ep = refined;
+        std::memcpy(indices, refinedIndices, sizeof(indices));
+      }
+    }
+  }
+
+  // The most significant bit of the first index is implicit and must be 0.
+  if (indices[0] & 8) {
+    for (int c = 0; c < 4; ++c)
+      std::swap(ep.q[0][c], ep.q[1][c]);
+    std::swap(ep.p[0], ep.p[1]);
+    for (int& index : indices)
+      index = 15 - index;
+  }
+
+  std::memset(outBlock, 0, BC7BlockSize);
+  BitWriter writer(outBlock);
+  writer.write(1u << 6, 7);
+  for (int c = 0; c < 4; ++c) {
+    writer.write((uint32_t)ep.q[0][c], 7);
+    writer.write((uint32_t)ep.q[1][c], 7);
+  }
+  writer.write((uint32_t)ep.p[0], 1);
+  writer.write((uint32_t)ep.p[1], 1);
+  writer.write((uint32_t)indices[0], 3);
+  for (int i = 1; i < 16; ++i)
+    writer.write((uint32_t)indices[i], 4);
+}
+
+} // namespace sss
@@ -0,0 +1,22 @@
+#pragma once
+#ifndef SSS_UTILS_BLOCKCOMPRESSION_H
+#define SSS_UTILS_BLOCKCOMPRESSION_H
+
+#include <cstddef>
+
+namespace sss {
+
+// CPU encoders of single 4x4 blocks, the pixels are given in row order.
+constexpr size_t BC4BlockSize = 8;
+constexpr size_t BC7BlockSize = 16;
+
+// One channel, 8 interpolated values between the extremes of the block.
+void encodeBC4Block(const unsigned char pixels[16], unsigned char outBlock[BC4BlockSize]);
+
+// Mode 6 only: one subset, RGBA endpoints with 7 bits and a shared bit each, 16 weights. Much
+// faster to encode than a search over the 8 modes, and good enough for smooth color maps.
+void encodeBC7Mode6Block(const unsigned char rgba[64], unsigned char outBlock[BC7BlockSize]);
+
+} // namespace sss
+
+#endif
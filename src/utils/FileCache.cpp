@@ -0,0 +1,55 @@
+#include "FileCache.h"
+#include "MappedFile.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace sss {
+
+uint64_t fnv1a(const void* data, size_t size, uint64_t hash) {
+  const unsigned char* bytes = (const unsigned char*)data;
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+bool FileCache::load(const std::string& name, uint64_t key, std::vector<char>& outData) const {
+  std::ifstream file(filePath(name, key).str(), std::ios::binary | std::ios::ate);
+  if (!file.is_open())
+    return false;
+
+  const std::streamsize size = file.tellg();
+  file.seekg(0);
+  outData.resize((size_t)size);
+  return (bool)file.read(outData.data(), size);
+}
+
+bool FileCache::map(const std::string& name, uint64_t key, MappedFile& outFile) const {
+  return outFile.open(filePath(name, key));
+}
+
+bool FileCache::store(const std::string& name, uint64_t key, const void* data,
+                      size_t size) const {
+  std::error_code err;
+  std::filesystem::create_directories(m_dir.str(), err);
+
+  const Path path = filePath(name, key);
+  std::ofstream file(path.str(), std::ios::binary | std::ios::trunc);
+  if (!file.is_open() || !file.write((const char*)data, (std::streamsize)size)) {
+    std::cout << "Failed to write cache file \"" << path << "\"" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+Path FileCache::filePath(const std::string& name, uint64_t key) const {
+  char hex[17];
+  std::snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)key);
+  return m_dir + (name + "-" + hex + ".bin");
+}
+
+} // namespace sss
@@ -0,0 +1,44 @@
+#pragma once
+#ifndef SSS_UTILS_FILECACHE_H
+#define SSS_UTILS_FILECACHE_H
+
+#include "Path.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace sss {
+
+class MappedFile;
+
+constexpr uint64_t FNVOffsetBasis = 14695981039346656037ull;
+
+// 64-bit FNV-1a, chain the calls by passing the previous hash.
+uint64_t fnv1a(const void* data, size_t size, uint64_t hash = FNVOffsetBasis);
+
+template <typename T> uint64_t fnv1a(const T& value, uint64_t hash = FNVOffsetBasis) {
+  return fnv1a(&value, sizeof(T), hash);
+}
+
+// Binary blobs saved in a directory, under a name and the hash of everything they depend on.
+class FileCache {
+public:
+  explicit FileCache(Path dir)
+    : m_dir(std::move(dir)) {}
+
+  bool load(const std::string& name, uint64_t key, std::vector<char>& outData) const;
+  // Maps the blob rather than reading it.
+  bool map(const std::string& name, uint64_t key, MappedFile& outFile) const;
+  bool store(const std::string& name, uint64_t key, const void* data, size_t size) const;
+
+private:
+  Path filePath(const std::string& name, uint64_t key) const;
+
+private:
+  Path m_dir;
+};
+
+} // namespace sss
+
+#endif
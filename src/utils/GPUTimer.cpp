@@ -0,0 +1,59 @@
+#include "GPUTimer.h"
+
+namespace sss {
+
+void GPUTimer::init() {
+  release();
+  glCreateQueries(GL_TIME_ELAPSED, NumQueries, m_queries);
+}
+
+void GPUTimer::release() {
+  if (!m_queries[0])
+    return;
+
+  glDeleteQueries(NumQueries, m_queries);
+  for (GLuint& q : m_queries)
+    q = 0;
+  m_next = 0;
+  m_numPending = 0;
+  m_elapsedMs = 0.0f;
+}
+
+void GPUTimer::begin() {
+  if (!m_queries[0])
+    return;
+
+  // Wait for the oldest query only if all of them are still in flight.
+  collect(m_numPending == NumQueries);
+  glBeginQuery(GL_TIME_ELAPSED, m_queries[m_next]);
+}
+
+void GPUTimer::end() {
+  if (!m_queries[0])
+    return;
+
+  glEndQuery(GL_TIME_ELAPSED);
+  m_next = (m_next + 1) % NumQueries;
+  ++m_numPending;
+}
+
+void GPUTimer::collect(bool wait) {
+  while (m_numPending > 0) {
+    GLuint query = m_queries[(m_next - m_numPending + NumQueries) % NumQueries];
+
+    GLint available = GL_FALSE;
+    glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available && !wait)
+      return;
+
+    GLuint64 ns = 0;
+    glGetQueryObjectui64v(query, GL_QUERY_RESULT, &ns);
+    --m_numPending;
+    wait = false;
+
+    const float ms = (float)ns * 1e-6f;
+    m_elapsedMs = m_elapsedMs == 0.0f ? ms : m_elapsedMs + (ms - m_elapsedMs) * 0.1f;
+  }
+}
+
+} // namespace sss
@@ -0,0 +1,52 @@
+#pragma once
+#ifndef SSS_UTILS_GPUTIMER_H
+#define SSS_UTILS_GPUTIMER_H
+
+#include <glad/glad.h>
+
+namespace sss {
+
+// Measures the GPU time spent between begin() and end() with GL_TIME_ELAPSED queries.
+// Results are read back a few frames later to avoid stalling the pipeline.
+class GPUTimer {
+public:
+  ~GPUTimer() { release(); }
+
+  void init();
+  void release();
+
+  void begin();
+  void end();
+
+  // Smoothed elapsed time in milliseconds.
+  float elapsedMs() const { return m_elapsedMs; }
+
+private:
+  void collect(bool wait);
+
+private:
+  static constexpr int NumQueries = 4;
+
+  GLuint m_queries[NumQueries] = {};
+  int m_next = 0;
+  int m_numPending = 0;
+  float m_elapsedMs = 0.0f;
+};
+
+// Times the GPU work issued in its scope.
+class ScopedGPUTimer {
+public:
+  explicit ScopedGPUTimer(GPUTimer& timer)
+    : m_timer(timer) {
+    m_timer.begin();
+  }
+
+  ~ScopedGPUTimer() { m_timer.end(); }
+
+private:
+  GPUTimer& m_timer;
+};
+
+} // namespace sss
+
+#endif
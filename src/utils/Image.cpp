@@ -10,13 +10,14 @@ namespace detail {
 
 unsigned char* LoadImage<unsigned char>::call(const char* path, int& width, int& height,
                                               int& nbChannels, int desiredChannels) {
-  stbi_set_flip_vertically_on_load(false);
+  // Per thread, images are decoded from the worker threads too.
+  stbi_set_flip_vertically_on_load_thread(false);
   return stbi_load(path, &width, &height, &nbChannels, desiredChannels);
 }
 
 float* LoadImage<float>::call(const char* path, int& width, int& height, int& nbChannels,
                               int desiredChannels) {
-  stbi_set_flip_vertically_on_load(true);
+  stbi_set_flip_vertically_on_load_thread(true);
   return stbi_loadf(path, &width, &height, &nbChannels, desiredChannels);
 }
 
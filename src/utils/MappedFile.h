@@ -0,0 +1,38 @@
+#pragma once
+#ifndef SSS_UTILS_MAPPEDFILE_H
+#define SSS_UTILS_MAPPEDFILE_H
+
+#include "Path.h"
+
+#include <cstddef>
+
+namespace sss {
+
+// Read-only memory mapping of a whole file, unmapped on destruction.
+class MappedFile {
+public:
+  MappedFile() = default;
+  ~MappedFile() { close(); }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  bool open(const Path& path);
+  void close();
+
+  bool isOpen() const { return m_data != nullptr; }
+  const char* data() const { return (const char*)m_data; }
+  size_t size() const { return m_size; }
+
+private:
+  void* m_data = nullptr;
+  size_t m_size = 0;
+#ifdef _WIN32
+  void* m_file = nullptr;
+  void* m_mapping = nullptr;
+#endif
+};
+
+} // namespace sss
+
+#endif
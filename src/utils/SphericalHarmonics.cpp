@@ -0,0 +1,64 @@
+#include "SphericalHarmonics.h"
+#include "ThreadPool.h"
+
+#include <vector>
+
+namespace sss {
+
+static void evalBasis(const Vec3f& d, float basis[IrradianceSH9::NumCoefficients]) {
+  basis[0] = 0.282095f;
+  basis[1] = 0.488603f * d.y;
+  basis[2] = 0.488603f * d.z;
+  basis[3] = 0.488603f * d.x;
+  basis[4] = 1.092548f * d.x * d.y;
+  basis[5] = 1.092548f * d.y * d.z;
+  basis[6] = 0.315392f * (3.0f * d.z * d.z - 1.0f);
+  basis[7] = 1.092548f * d.x * d.z;
+  basis[8] = 0.546274f * (d.x * d.x - d.y * d.y);
+}
+
+void IrradianceSH9::project(const HDRImage& env, ThreadPool& pool) {
+  const int width = env.width();
+  const int height = env.height();
+  const int channels = env.nbChannels();
+  const float* pixels = env.pixels();
+
+  // One partial sum per row, reduced once all the rows are done.
+  std::vector<IrradianceSH9> rows((size_t)height);
+  pool.parallelFor(0, height, [&](int y) {
+    const float elevation = ((float)y + 0.5f) / (float)height * Pi - 0.5f * Pi;
+    const float cosElevation = glm::cos(elevation);
+    const float sinElevation = glm::sin(elevation);
+    // Solid angle of the texels of this row.
+    const float dOmega = (TwoPi / (float)width) * (Pi / (float)height) * cosElevation;
+
+    Vec3f* sums = rows[y].coefficients;
+    const float* row = pixels + (size_t)y * width * channels;
+    for (int x = 0; x < width; ++x) {
+      const float azimuth = ((float)x + 0.5f) / (float)width * TwoPi - Pi;
+      const Vec3f dir(glm::cos(azimuth) * cosElevation, sinElevation,
+                      glm::sin(azimuth) * cosElevation);
+      const float* texel = row + (size_t)x * channels;
+      const Vec3f radiance = Vec3f(texel[0], texel[1], texel[2]) * dOmega;
+
+      float basis[NumCoefficients];
+      evalBasis(dir, basis);
+      for (int i = 0; i < NumCoefficients; ++i)
+        sums[i] += radiance * basis[i];
+    }
+  });
+
+  for (Vec3f& c : coefficients)
+    c = Vec3fZero;
+  for (const IrradianceSH9& row : rows) {
+    for (int i = 0; i < NumCoefficients; ++i)
+      coefficients[i] += row.coefficients[i];
+  }
+
+  // Clamped cosine convolution of each band (Pi, 2Pi/3, Pi/4), divided by Pi.
+  const float bandScale[] = {1.0f, 2.0f / 3.0f, 0.25f};
+  for (int i = 0; i < NumCoefficients; ++i)
+    coefficients[i] *= bandScale[i == 0 ? 0 : i < 4 ? 1 : 2];
+}
+
+} // namespace sss
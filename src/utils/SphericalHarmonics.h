@@ -0,0 +1,26 @@
+#pragma once
+#ifndef SSS_UTILS_SPHERICALHARMONICS_H
+#define SSS_UTILS_SPHERICALHARMONICS_H
+
+#include "../MathDefines.h"
+#include "Image.h"
+
+namespace sss {
+
+class ThreadPool;
+
+// Diffuse irradiance of an environment stored in the first 9 real spherical harmonics
+// (Ramamoorthi and Hanrahan, An Efficient Representation for Irradiance Environment Maps).
+struct IrradianceSH9 {
+  static constexpr int NumCoefficients = 9;
+  Vec3f coefficients[NumCoefficients] = {};
+
+  // Projects an equirectangular radiance map, laid out as sphericalToUV() in
+  // env-to-cube-map.comp, and convolves it with the clamped cosine lobe. The coefficients are
+  // divided by Pi so that evaluating them gives the same values as a pre-convolved map.
+  void project(const HDRImage& env, ThreadPool& pool);
+};
+
+} // namespace sss
+
+#endif
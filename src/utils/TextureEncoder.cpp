@@ -0,0 +1,396 @@
+#include "TextureEncoder.h"
+#include "BlockCompression.h"
+#include "TextureFile.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+
+namespace sss {
+
+namespace {
+
+// Bump when the encoders or the layout below change, to invalidate the cached textures.
+constexpr uint32_t TextureCacheVersion = 2;
+
+// Cache layout: the header, the 64-bit size of each level, then the levels.
+struct TextureCacheHeader {
+  uint32_t internalFormat;
+  uint32_t format;
+  uint32_t width;
+  uint32_t height;
+  uint32_t numLevels;
+};
+
+GLenum uncompressedInternalFormat(int numChannels) {
+  const GLenum formats[] = {GL_R8, GL_RG8, GL_RGB8, GL_RGBA8};
+  return formats[numChannels - 1];
+}
+
+GLenum uncompressedFormat(int numChannels) {
+  const GLenum formats[] = {GL_RED, GL_RG, GL_RGB, GL_RGBA};
+  return formats[numChannels - 1];
+}
+
+size_t blockSize(GLenum internalFormat) {
+  return internalFormat == GL_COMPRESSED_RED_RGTC1 ? BC4BlockSize : BC7BlockSize;
+}
+
+// The 16 RGBA pixels of a block, clamped to the edges of the level.
+void gatherBlock(const std::vector<unsigned char>& rgba, int w, int h, int bx, int by,
+                 unsigned char outBlock[64]) {
+  for (int y = 0; y < 4; ++y) {
+    for (int x = 0; x < 4; ++x) {
+      const int px = std::min(bx * 4 + x, w - 1);
+      const int py = std::min(by * 4 + y, h - 1);
+      std::memcpy(outBlock + 4 * (4 * y + x), rgba.data() + 4 * ((size_t)py * w + px), 4);
+    }
+  }
+}
+
+void encodeBlock(GLenum internalFormat, const unsigned char rgba[64], unsigned char* out) {
+  unsigned char channel[16];
+  switch (internalFormat) {
+  case GL_COMPRESSED_RGBA_BPTC_UNORM:
+    encodeBC7Mode6Block(rgba, out);
+    break;
+  case GL_COMPRESSED_RG_RGTC2:
+    // Red block, then green block.
+    for (int c = 0; c < 2; ++c) {
+      for (int i = 0; i < 16; ++i)
+        channel[i] = rgba[4 * i + c];
+      encodeBC4Block(channel, out + c * BC4BlockSize);
+    }
+    break;
+  default:
+    for (int i = 0; i < 16; ++i)
+      channel[i] = rgba[4 * i];
+    encodeBC4Block(channel, out);
+    break;
+  }
+}
+
+void encodeLevel(const std::vector<unsigned char>& rgba, int w, int h, EncodedTexture& texture,
+                 int numChannels, ThreadPool* pool) {
+  const size_t offset = texture.data.size();
+
+  if (!texture.isCompressed()) {
+    const size_t numPixels = (size_t)w * h;
+    texture.data.resize(offset + numPixels * numChannels);
+    unsigned char* out = texture.data.data() + offset;
+    for (size_t i = 0; i < numPixels; ++i)
+      std::memcpy(out + i * numChannels, rgba.data() + 4 * i, numChannels);
+    texture.levelSizes.push_back(numPixels * numChannels);
+    texture.levelOffsets.push_back(offset);
+    return;
+  }
+
+  const int numBlocksX = (w + 3) / 4;
+  const int numBlocksY = (h + 3) / 4;
+  const size_t size = blockSize(texture.internalFormat);
+  const size_t rowSize = (size_t)numBlocksX * size;
+  texture.data.resize(offset + rowSize * numBlocksY);
+
+  unsigned char* out = texture.data.data() + offset;
+  const auto encodeRow = [&](int by) {
+    unsigned char block[64];
+    for (int bx = 0; bx < numBlocksX; ++bx) {
+      gatherBlock(rgba, w, h, bx, by, block);
+      encodeBlock(texture.internalFormat, block, out + by * rowSize + bx * size);
+    }
+  };
+
+  if (pool) {
+    pool->parallelFor(0, numBlocksY, encodeRow);
+  } else {
+    for (int by = 0; by < numBlocksY; ++by)
+      encodeRow(by);
+  }
+  texture.levelSizes.push_back(rowSize * numBlocksY);
+  texture.levelOffsets.push_back(offset);
+}
+
+// 2x2 box filter, the last row or column is repeated for odd sizes.
+std::vector<unsigned char> downsample(const std::vector<unsigned char>& rgba, int w, int h) {
+  const int dw = std::max(w / 2, 1);
+  const int dh = std::max(h / 2, 1);
+  std::vector<unsigned char> result((size_t)dw * dh * 4);
+  for (int y = 0; y < dh; ++y) {
+    const int y0 = std::min(2 * y, h - 1);
+    const int y1 = std::min(2 * y + 1, h - 1);
+    for (int x = 0; x < dw; ++x) {
+      const int x0 = std::min(2 * x, w - 1);
+      const int x1 = std::min(2 * x + 1, w - 1);
+      for (int c = 0; c < 4; ++c) {
+        const int sum = rgba[4 * ((size_t)y0 * w + x0) + c] + rgba[4 * ((size_t)y0 * w + x1) + c] +
+                        rgba[4 * ((size_t)y1 * w + x0) + c] + rgba[4 * ((size_t)y1 * w + x1) + c];
+        result[4 * ((size_t)y * dw + x) + c] = (unsigned char)((sum + 2) / 4);
+      }
+    }
+  }
+  return result;
+}
+
+// The levels are left in the mapped file.
+bool parseCachedTexture(const std::shared_ptr<const MappedFile>& file,
+                        EncodedTexture& outTexture) {
+  const char* data = file->data();
+  if (file->size() < sizeof(TextureCacheHeader))
+    return false;
+
+  TextureCacheHeader header;
+  std::memcpy(&header, data, sizeof(header));
+  const size_t levelsOffset = sizeof(header);
+  const size_t dataOffset = levelsOffset + header.numLevels * sizeof(uint64_t);
+  // The levels are passed to glTextureStorage2D, they cannot go past the 1x1 one.
+  if (header.width == 0 || header.height == 0 || header.width > MaxTextureSize ||
+      header.height > MaxTextureSize || header.numLevels == 0 ||
+      header.numLevels > (uint32_t)fullChainLength((int)header.width, (int)header.height) ||
+      file->size() < dataOffset)
+    return false;
+
+  outTexture = EncodedTexture();
+  outTexture.internalFormat = header.internalFormat;
+  outTexture.format = header.format;
+  outTexture.width = (int)header.width;
+  outTexture.height = (int)header.height;
+
+  size_t offset = dataOffset;
+  for (uint32_t level = 0; level < header.numLevels; ++level) {
+    uint64_t levelSize = 0;
+    std::memcpy(&levelSize, data + levelsOffset + level * sizeof(uint64_t), sizeof(levelSize));
+    if (levelSize > file->size() - offset)
+      return false;
+    outTexture.levelSizes.push_back((size_t)levelSize);
+    outTexture.levelOffsets.push_back(offset);
+    offset += (size_t)levelSize;
+  }
+  if (file->size() != offset)
+    return false;
+
+  outTexture.file = file;
+  return true;
+}
+
+std::vector<char> serializeTexture(const EncodedTexture& texture) {
+  TextureCacheHeader header;
+  header.internalFormat = texture.internalFormat;
+  header.format = texture.format;
+  header.width = (uint32_t)texture.width;
+  header.height = (uint32_t)texture.height;
+  header.numLevels = (uint32_t)texture.numLevels();
+
+  std::vector<char> data(sizeof(header) + texture.levelSizes.size() * sizeof(uint64_t) +
+                         texture.data.size());
+  char* out = data.data();
+  std::memcpy(out, &header, sizeof(header));
+  out += sizeof(header);
+  for (size_t levelSize : texture.levelSizes) {
+    const uint64_t size = levelSize;
+    std::memcpy(out, &size, sizeof(size));
+    out += sizeof(size);
+  }
+  std::memcpy(out, texture.data.data(), texture.data.size());
+  return data;
+}
+
+void logTexture(const Path& path, const EncodedTexture& texture, const char* source,
+                std::chrono::steady_clock::time_point start) {
+  const std::chrono::duration<float, std::milli> elapsed =
+    std::chrono::steady_clock::now() - start;
+  std::cout << "Texture \"" << path.file() << "\" (" << texture.width << "x" << texture.height
+            << " " << textureFormatName(texture.internalFormat) << ", " << texture.numLevels()
+            << " level(s), " << texture.byteSize() / 1024 << " KiB) " << source << " in "
+            << elapsed.count() << " ms" << std::endl;
+}
+
+} // namespace
+
+size_t EncodedTexture::byteSize() const {
+  size_t size = 0;
+  for (size_t levelSize : levelSizes)
+    size += levelSize;
+  return size;
+}
+
+void encodeTexture(const RGBImage& image, TextureUsage usage, bool compress,
+                   EncodedTexture& outTexture, ThreadPool* pool) {
+  const int w = image.width();
+  const int h = image.height();
+  const int srcChannels = image.nbChannels();
+
+  // Expanded to RGBA, the formats then only keep the channels they need.
+  std::vector<unsigned char> rgba((size_t)w * h * 4);
+  const unsigned char* src = image.pixels();
+  for (size_t i = 0; i < (size_t)w * h; ++i) {
+    const unsigned char* p = src + i * srcChannels;
+    unsigned char* q = rgba.data() + 4 * i;
+    q[0] = p[0];
+    q[1] = srcChannels == 1 ? p[0] : p[1];
+    q[2] = srcChannels == 1 ? p[0] : srcChannels == 2 ? 0 : p[2];
+    q[3] = srcChannels == 4 ? p[3] : 255;
+  }
+
+  int numChannels = srcChannels;
+  if (usage == TextureUsage::Color)
+    numChannels = srcChannels == 4 ? 4 : 3;
+  else if (usage == TextureUsage::Normal)
+    numChannels = 2;
+  else if (usage == TextureUsage::Mono)
+    numChannels = 1;
+
+  outTexture = EncodedTexture();
+  outTexture.width = w;
+  outTexture.height = h;
+  if (compress && usage != TextureUsage::Data) {
+    const GLenum formats[] = {GL_COMPRESSED_RGBA_BPTC_UNORM, GL_COMPRESSED_RG_RGTC2,
+                              GL_COMPRESSED_RED_RGTC1};
+    outTexture.internalFormat = formats[(int)usage];
+  } else {
+    outTexture.internalFormat = uncompressedInternalFormat(numChannels);
+    outTexture.format = uncompressedFormat(numChannels);
+  }
+
+  const int numLevels = (int)std::log2((float)std::max(w, h)) + 1;
+  int lw = w;
+  int lh = h;
+  for (int level = 0; level < numLevels; ++level) {
+    encodeLevel(rgba, lw, lh, outTexture, numChannels, pool);
+    if (level + 1 < numLevels) {
+      rgba = downsample(rgba, lw, lh);
+      lw = std::max(lw / 2, 1);
+      lh = std::max(lh / 2, 1);
+    }
+  }
+}
+
+bool readTexture(const Path& path, TextureUsage usage, bool compress, EncodedTexture& outTexture,
+                 ThreadPool* pool) {
+  if (isTextureFile(path))
+    return readTextureFile(path, usage, outTexture);
+
+  RGBImage image;
+  if (!image.load(path))
+    return false;
+
+  encodeTexture(image, usage, compress, outTexture, pool);
+  return true;
+}
+
+bool loadEncodedTexture(const Path& path, TextureUsage usage, bool compress, const FileCache& cache,
+                        EncodedTexture& outTexture, ThreadPool* pool) {
+  const auto start = std::chrono::steady_clock::now();
+
+  // Already in a GL format with its levels, caching it would only copy it.
+  if (isTextureFile(path)) {
+    if (!readTextureFile(path, usage, outTexture))
+      return false;
+
+    logTexture(path, outTexture, "mapped", start);
+    return true;
+  }
+
+  uint64_t key = fnv1a(TextureCacheVersion);
+  key = fnv1a(path.str().data(), path.str().size(), key);
+  std::error_code err;
+  key = fnv1a(std::filesystem::file_size(path.str(), err), key);
+  key = fnv1a(std::filesystem::last_write_time(path.str(), err), key);
+  key = fnv1a(usage, key);
+  key = fnv1a(compress, key);
+
+  const std::string name = "texture-" + path.fileName();
+  auto file = std::make_shared<MappedFile>();
+  const bool cached = cache.map(name, key, *file) && parseCachedTexture(file, outTexture);
+  if (!cached) {
+    // An invalid blob is overwritten, which Windows does not allow while it is mapped.
+    file->close();
+    if (!readTexture(path, usage, compress, outTexture, pool))
+      return false;
+
+    const std::vector<char> data = serializeTexture(outTexture);
+    cache.store(name, key, data.data(), data.size());
+  }
+
+  logTexture(path, outTexture, cached ? "mapped from cache" : "encoded", start);
+  return true;
+}
+
+int fullChainLength(int width, int height) {
+  return (int)std::log2((float)std::max(width, height)) + 1;
+}
+
+GLuint uploadTexture(const EncodedTexture& texture) {
+  // Compressed formats cannot be mipmapped by GL, they are only filtered from level 0.
+  const int fullChain = fullChainLength(texture.width, texture.height);
+  const bool generateMipmap = texture.numLevels() == 1 && !texture.isCompressed();
+  const int numLevels = generateMipmap ? fullChain : texture.numLevels();
+
+  GLuint tex = 0;
+  glCreateTextures(GL_TEXTURE_2D, 1, &tex);
+  glTextureStorage2D(tex, numLevels, texture.internalFormat, texture.width, texture.height);
+  glTextureParameteri(tex, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTextureParameteri(tex, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTextureParameteri(tex, GL_TEXTURE_MIN_FILTER,
+                      numLevels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+  glTextureParameteri(tex, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+  // The rows of the uncompressed levels are tightly packed.
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  for (int level = 0; level < texture.numLevels(); ++level) {
+    const GLsizei w = std::max(texture.width >> level, 1);
+    const GLsizei h = std::max(texture.height >> level, 1);
+    const unsigned char* data = texture.levelData(level);
+    if (texture.isCompressed())
+      glCompressedTextureSubImage2D(tex, level, 0, 0, w, h, texture.internalFormat,
+                                    (GLsizei)texture.levelSizes[level], data);
+    else
+      glTextureSubImage2D(tex, level, 0, 0, w, h, texture.format, texture.type, data);
+  }
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+  if (generateMipmap)
+    glGenerateTextureMipmap(tex);
+  return tex;
+}
+
+const char* textureFormatName(GLenum internalFormat) {
+  switch (internalFormat) {
+  case GL_COMPRESSED_RGBA_BPTC_UNORM:
+    return "BC7";
+  case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+    return "BC7 sRGB";
+  case GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT:
+    return "BC6H";
+  case GL_COMPRESSED_RG_RGTC2:
+    return "BC5";
+  case GL_COMPRESSED_RED_RGTC1:
+    return "BC4";
+  case CompressedRGBAS3TCDXT1:
+    return "BC1";
+  case CompressedRGBAS3TCDXT5:
+    return "BC3";
+  case GL_R8:
+    return "R8";
+  case GL_RG8:
+    return "RG8";
+  case GL_RGB8:
+    return "RGB8";
+  case GL_RGBA8:
+    return "RGBA8";
+  case GL_SRGB8_ALPHA8:
+    return "RGBA8 sRGB";
+  case GL_RGBA16F:
+    return "RGBA16F";
+  case GL_RGBA32F:
+    return "RGBA32F";
+  default:
+    return "unknown";
+  }
+}
+
+} // namespace sss
@@ -0,0 +1,83 @@
+#pragma once
+#ifndef SSS_UTILS_TEXTUREENCODER_H
+#define SSS_UTILS_TEXTUREENCODER_H
+
+#include "FileCache.h"
+#include "Image.h"
+#include "MappedFile.h"
+#include "Path.h"
+
+#include <glad/glad.h>
+#include <memory>
+#include <vector>
+
+namespace sss {
+
+class ThreadPool;
+
+// How the texels are sampled, which decides the internal format.
+enum class TextureUsage {
+  // RGB(A), BC7 when compressed. UNORM rather than sRGB, the shaders linearize the albedo
+  // themselves when gamma correction is enabled.
+  Color,
+  // Tangent-space XY, BC5 when compressed. The shaders reconstruct Z.
+  Normal,
+  // Red channel only, BC4 when compressed.
+  Mono,
+  // Exact texels (LUTs, encoded coefficients), never compressed.
+  Data,
+};
+
+// Every mip level of a 2D texture in its GL format, ready to be uploaded.
+struct EncodedTexture {
+  GLenum internalFormat = GL_NONE;
+  // Pixel format and type of the uncompressed levels, GL_NONE for block-compressed ones.
+  GLenum format = GL_NONE;
+  GLenum type = GL_UNSIGNED_BYTE;
+  int width = 0;
+  int height = 0;
+  std::vector<size_t> levelSizes;
+  // From the start of the bytes, see levelData().
+  std::vector<size_t> levelOffsets;
+  std::vector<unsigned char> data;
+  // Set instead of data when the levels are read in place from a mapped file.
+  std::shared_ptr<const MappedFile> file;
+
+  bool isCompressed() const { return format == GL_NONE; }
+  int numLevels() const { return (int)levelSizes.size(); }
+
+  const unsigned char* levelData(int level) const {
+    return (file ? (const unsigned char*)file->data() : data.data()) + levelOffsets[level];
+  }
+  size_t byteSize() const;
+};
+
+// Larger than any GL implementation allows, which keeps the level byte sizes from overflowing.
+constexpr int MaxTextureSize = 1 << 16;
+
+// Number of levels from a width x height level down to 1x1.
+int fullChainLength(int width, int height);
+
+// Converts an 8-bit image and its box-filtered mip chain to the format of usage. The blocks are
+// compressed from the threads of pool when given.
+void encodeTexture(const RGBImage& image, TextureUsage usage, bool compress,
+                   EncodedTexture& outTexture, ThreadPool* pool = nullptr);
+
+// Reads a DDS or KTX2 file as it is stored, see readTextureFile(), or decodes and encodes any
+// other image. Does not use GL.
+bool readTexture(const Path& path, TextureUsage usage, bool compress, EncodedTexture& outTexture,
+                 ThreadPool* pool = nullptr);
+
+// readTexture(), through the cache for the images that have to be encoded. Does not use GL.
+bool loadEncodedTexture(const Path& path, TextureUsage usage, bool compress, const FileCache& cache,
+                        EncodedTexture& outTexture, ThreadPool* pool = nullptr);
+
+// GL thread. Repeated, trilinear. The mip chain of the uncompressed textures stored without one
+// is generated on upload.
+GLuint uploadTexture(const EncodedTexture& texture);
+
+const char* textureFormatName(GLenum internalFormat);
+
+} // namespace sss
+
+#endif
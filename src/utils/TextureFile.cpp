@@ -0,0 +1,340 @@
+#include "TextureFile.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+namespace sss {
+
+namespace {
+
+struct FileFormat {
+  uint32_t dxgiFormat;
+  uint32_t vkFormat;
+  GLenum internalFormat;
+  // GL_NONE for block-compressed formats.
+  GLenum format;
+  GLenum type;
+  // Per 4x4 block when compressed, per pixel otherwise.
+  uint32_t size;
+};
+
+// The DXGI_FORMAT of DDS and the VkFormat of KTX2 with a GL equivalent.
+const FileFormat FileFormats[] = {
+  {61, 9, GL_R8, GL_RED, GL_UNSIGNED_BYTE, 1},
+  {49, 16, GL_RG8, GL_RG, GL_UNSIGNED_BYTE, 2},
+  {28, 37, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, 4},
+  {29, 43, GL_SRGB8_ALPHA8, GL_RGBA, GL_UNSIGNED_BYTE, 4},
+  {87, 44, GL_RGBA8, GL_BGRA, GL_UNSIGNED_BYTE, 4},
+  {10, 97, GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT, 8},
+  {2, 109, GL_RGBA32F, GL_RGBA, GL_FLOAT, 16},
+  {71, 133, CompressedRGBAS3TCDXT1, GL_NONE, GL_NONE, 8},
+  {77, 137, CompressedRGBAS3TCDXT5, GL_NONE, GL_NONE, 16},
+  {80, 139, GL_COMPRESSED_RED_RGTC1, GL_NONE, GL_NONE, 8},
+  {83, 141, GL_COMPRESSED_RG_RGTC2, GL_NONE, GL_NONE, 16},
+  {95, 143, GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT, GL_NONE, GL_NONE, 16},
+  {98, 145, GL_COMPRESSED_RGBA_BPTC_UNORM, GL_NONE, GL_NONE, 16},
+  {99, 146, GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM, GL_NONE, GL_NONE, 16},
+};
+
+const FileFormat* findFormat(uint32_t FileFormat::*field, uint32_t value) {
+  for (const FileFormat& format : FileFormats) {
+    if (format.*field == value)
+      return &format;
+  }
+  return nullptr;
+}
+
+size_t levelByteSize(const FileFormat& format, int level, int width, int height) {
+  const size_t w = (size_t)std::max(width >> level, 1);
+  const size_t h = (size_t)std::max(height >> level, 1);
+  if (format.format == GL_NONE)
+    return ((w + 3) / 4) * ((h + 3) / 4) * format.size;
+  return w * h * format.size;
+}
+
+// The shaders linearize the color textures themselves, see TextureUsage::Color, so the sRGB
+// formats are sampled as UNORM like the encoded images.
+GLenum usageInternalFormat(const FileFormat& format, TextureUsage usage) {
+  if (usage != TextureUsage::Color)
+    return format.internalFormat;
+  if (format.internalFormat == GL_SRGB8_ALPHA8)
+    return GL_RGBA8;
+  if (format.internalFormat == GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM)
+    return GL_COMPRESSED_RGBA_BPTC_UNORM;
+  return format.internalFormat;
+}
+
+void setFormat(const FileFormat& format, TextureUsage usage, int width, int height,
+               EncodedTexture& outTexture) {
+  outTexture = EncodedTexture();
+  outTexture.internalFormat = usageInternalFormat(format, usage);
+  outTexture.format = format.format;
+  outTexture.type = format.type;
+  outTexture.width = width;
+  outTexture.height = height;
+}
+
+constexpr uint32_t fourCC(char a, char b, char c, char d) {
+  return (uint32_t)a | ((uint32_t)b << 8) | ((uint32_t)c << 16) | ((uint32_t)d << 24);
+}
+
+// See the DDS_HEADER documentation of Direct3D.
+struct DDSPixelFormat {
+  uint32_t size;
+  uint32_t flags;
+  uint32_t fourCC;
+  uint32_t rgbBitCount;
+  uint32_t rMask;
+  uint32_t gMask;
+  uint32_t bMask;
+  uint32_t aMask;
+};
+
+struct DDSHeader {
+  uint32_t size;
+  uint32_t flags;
+  uint32_t height;
+  uint32_t width;
+  uint32_t pitchOrLinearSize;
+  uint32_t depth;
+  uint32_t mipMapCount;
+  uint32_t reserved1[11];
+  DDSPixelFormat pixelFormat;
+  uint32_t caps;
+  uint32_t caps2;
+  uint32_t caps3;
+  uint32_t caps4;
+  uint32_t reserved2;
+};
+
+struct DDSHeaderDX10 {
+  uint32_t dxgiFormat;
+  uint32_t resourceDimension;
+  uint32_t miscFlag;
+  uint32_t arraySize;
+  uint32_t miscFlags2;
+};
+
+constexpr uint32_t DDSMagic = fourCC('D', 'D', 'S', ' ');
+constexpr uint32_t DDSMipMapCount = 0x20000;
+constexpr uint32_t DDSPixelFourCC = 0x4;
+constexpr uint32_t DDSPixelRGB = 0x40;
+constexpr uint32_t DDSPixelLuminance = 0x20000;
+constexpr uint32_t DDSCubeMap = 0x200;
+constexpr uint32_t DDSVolume = 0x200000;
+constexpr uint32_t DX10Texture2D = 3;
+constexpr uint32_t DX10TextureCube = 0x4;
+
+// The DXGI_FORMAT of the legacy pixel formats.
+uint32_t legacyDDSFormat(const DDSPixelFormat& pf) {
+  if (pf.flags & DDSPixelFourCC) {
+    switch (pf.fourCC) {
+    case fourCC('D', 'X', 'T', '1'):
+      return 71;
+    case fourCC('D', 'X', 'T', '5'):
+      return 77;
+    case fourCC('A', 'T', 'I', '1'):
+    case fourCC('B', 'C', '4', 'U'):
+      return 80;
+    case fourCC('A', 'T', 'I', '2'):
+    case fourCC('B', 'C', '5', 'U'):
+      return 83;
+    case 113: // D3DFMT_A16B16G16R16F
+      return 10;
+    case 116: // D3DFMT_A32B32G32R32F
+      return 2;
+    default:
+      return 0;
+    }
+  }
+
+  if ((pf.flags & DDSPixelRGB) && pf.rgbBitCount == 32) {
+    if (pf.rMask == 0x00ff0000 && pf.gMask == 0x0000ff00 && pf.bMask == 0x000000ff)
+      return 87;
+    if (pf.rMask == 0x000000ff && pf.gMask == 0x0000ff00 && pf.bMask == 0x00ff0000)
+      return 28;
+  }
+  if ((pf.flags & (DDSPixelRGB | DDSPixelLuminance)) && pf.rgbBitCount == 8)
+    return 61;
+  return 0;
+}
+
+bool readDDS(const Path& path, const MappedFile& file, TextureUsage usage,
+             EncodedTexture& outTexture) {
+  if (file.size() < 4 + sizeof(DDSHeader)) {
+    std::cout << "Truncated DDS file \"" << path << "\"" << std::endl;
+    return false;
+  }
+
+  DDSHeader header;
+  std::memcpy(&header, file.data() + 4, sizeof(header));
+  size_t offset = 4 + sizeof(header);
+
+  uint32_t dxgiFormat = legacyDDSFormat(header.pixelFormat);
+  bool is2D = !(header.caps2 & (DDSCubeMap | DDSVolume));
+  if ((header.pixelFormat.flags & DDSPixelFourCC) &&
+      header.pixelFormat.fourCC == fourCC('D', 'X', '1', '0')) {
+    DDSHeaderDX10 dx10;
+    if (file.size() < offset + sizeof(dx10)) {
+      std::cout << "Truncated DDS file \"" << path << "\"" << std::endl;
+      return false;
+    }
+    std::memcpy(&dx10, file.data() + offset, sizeof(dx10));
+    offset += sizeof(dx10);
+
+    dxgiFormat = dx10.dxgiFormat;
+    is2D = dx10.resourceDimension == DX10Texture2D && !(dx10.miscFlag & DX10TextureCube) &&
+           dx10.arraySize <= 1;
+  }
+
+  if (!is2D) {
+    std::cout << "DDS file \"" << path << "\" is not a 2D texture" << std::endl;
+    return false;
+  }
+  const FileFormat* format = findFormat(&FileFormat::dxgiFormat, dxgiFormat);
+  if (!format) {
+    std::cout << "Unsupported DDS format in \"" << path << "\"" << std::endl;
+    return false;
+  }
+
+  const int width = (int)header.width;
+  const int height = (int)header.height;
+  int numLevels = 1;
+  if ((header.flags & DDSMipMapCount) && header.mipMapCount > 1)
+    numLevels = (int)header.mipMapCount;
+  if (width <= 0 || height <= 0 || width > MaxTextureSize || height > MaxTextureSize ||
+      numLevels > fullChainLength(width, height)) {
+    std::cout << "Invalid DDS size in \"" << path << "\"" << std::endl;
+    return false;
+  }
+
+  // The levels follow each other, from the largest.
+  setFormat(*format, usage, width, height, outTexture);
+  for (int level = 0; level < numLevels; ++level) {
+    const size_t size = levelByteSize(*format, level, width, height);
+    outTexture.levelSizes.push_back(size);
+    outTexture.levelOffsets.push_back(offset);
+    offset += size;
+  }
+  if (offset > file.size()) {
+    std::cout << "Truncated DDS file \"" << path << "\"" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// See the KTX 2.0 specification of the Khronos Group.
+struct KTX2Header {
+  unsigned char identifier[12];
+  uint32_t vkFormat;
+  uint32_t typeSize;
+  uint32_t pixelWidth;
+  uint32_t pixelHeight;
+  uint32_t pixelDepth;
+  uint32_t layerCount;
+  uint32_t faceCount;
+  uint32_t levelCount;
+  uint32_t supercompressionScheme;
+  uint32_t dfdByteOffset;
+  uint32_t dfdByteLength;
+  uint32_t kvdByteOffset;
+  uint32_t kvdByteLength;
+  uint64_t sgdByteOffset;
+  uint64_t sgdByteLength;
+};
+
+struct KTX2Level {
+  uint64_t byteOffset;
+  uint64_t byteLength;
+  uint64_t uncompressedByteLength;
+};
+
+const unsigned char KTX2Identifier[12] = {0xab, 'K', 'T', 'X', ' ', '2',
+                                          '0',  0xbb, '\r', '\n', 0x1a, '\n'};
+
+bool readKTX2(const Path& path, const MappedFile& file, TextureUsage usage,
+              EncodedTexture& outTexture) {
+  KTX2Header header;
+  if (file.size() < sizeof(header)) {
+    std::cout << "Truncated KTX2 file \"" << path << "\"" << std::endl;
+    return false;
+  }
+  std::memcpy(&header, file.data(), sizeof(header));
+
+  if (std::memcmp(header.identifier, KTX2Identifier, sizeof(KTX2Identifier)) != 0) {
+    std::cout << "Invalid KTX2 file \"" << path << "\"" << std::endl;
+    return false;
+  }
+  if (header.pixelDepth > 0 || header.layerCount > 1 || header.faceCount != 1) {
+    std::cout << "KTX2 file \"" << path << "\" is not a 2D texture" << std::endl;
+    return false;
+  }
+  const FileFormat* format = findFormat(&FileFormat::vkFormat, header.vkFormat);
+  if (!format || header.supercompressionScheme != 0) {
+    std::cout << "Unsupported KTX2 format in \"" << path << "\"" << std::endl;
+    return false;
+  }
+
+  const int width = (int)header.pixelWidth;
+  const int height = (int)header.pixelHeight;
+  // 0 asks the loader to generate the chain, uploadTexture() does.
+  const int numLevels = std::max((int)header.levelCount, 1);
+  if (width <= 0 || height <= 0 || width > MaxTextureSize || height > MaxTextureSize ||
+      numLevels > fullChainLength(width, height) ||
+      file.size() < sizeof(header) + numLevels * sizeof(KTX2Level)) {
+    std::cout << "Invalid KTX2 size in \"" << path << "\"" << std::endl;
+    return false;
+  }
+
+  // The level index goes from the largest level, the levels themselves are stored from the
+  // smallest.
+  setFormat(*format, usage, width, height, outTexture);
+  for (int level = 0; level < numLevels; ++level) {
+    KTX2Level index;
+    std::memcpy(&index, file.data() + sizeof(header) + level * sizeof(KTX2Level), sizeof(index));
+
+    const size_t size = levelByteSize(*format, level, width, height);
+    if (index.byteLength != size || index.byteOffset > file.size() ||
+        index.byteLength > file.size() - index.byteOffset) {
+      std::cout << "Invalid KTX2 level " << level << " in \"" << path << "\"" << std::endl;
+      return false;
+    }
+    outTexture.levelSizes.push_back(size);
+    outTexture.levelOffsets.push_back((size_t)index.byteOffset);
+  }
+  return true;
+}
+
+} // namespace
+
+bool isTextureFile(const Path& path) {
+  std::string ext = path.ext();
+  std::transform(ext.begin(), ext.end(), ext.begin(),
+                 [](unsigned char c) { return (char)std::tolower(c); });
+  return ext == "dds" || ext == "ktx2";
+}
+
+bool readTextureFile(const Path& path, TextureUsage usage, EncodedTexture& outTexture) {
+  auto file = std::make_shared<MappedFile>();
+  if (!file->open(path)) {
+    std::cout << "Failed to open texture \"" << path << "\"" << std::endl;
+    return false;
+  }
+
+  uint32_t magic = 0;
+  if (file->size() >= sizeof(magic))
+    std::memcpy(&magic, file->data(), sizeof(magic));
+
+  const bool read = magic == DDSMagic ? readDDS(path, *file, usage, outTexture)
+                                      : readKTX2(path, *file, usage, outTexture);
+  if (!read)
+    return false;
+
+  outTexture.file = std::move(file);
+  return true;
+}
+
+} // namespace sss
@@ -0,0 +1,27 @@
+#pragma once
+#ifndef SSS_UTILS_TEXTUREFILE_H
+#define SSS_UTILS_TEXTUREFILE_H
+
+#include "Path.h"
+#include "TextureEncoder.h"
+
+#include <glad/glad.h>
+
+namespace sss {
+
+// EXT_texture_compression_s3tc, supported by every desktop driver but not part of the core
+// profile glad is generated for.
+constexpr GLenum CompressedRGBAS3TCDXT1 = 0x83F1;
+constexpr GLenum CompressedRGBAS3TCDXT5 = 0x83F3;
+
+// DDS or KTX2, from the extension.
+bool isTextureFile(const Path& path);
+
+// Maps a DDS or KTX2 file and points the levels of outTexture into it, they are uploaded as they
+// are stored. 2D textures only, without supercompression. The sRGB formats are read as UNORM for
+// TextureUsage::Color. Does not use GL.
+bool readTextureFile(const Path& path, TextureUsage usage, EncodedTexture& outTexture);
+
+} // namespace sss
+
+#endif
@@ -0,0 +1,95 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace sss {
+
+ThreadPool::ThreadPool(unsigned numThreads) {
+  if (numThreads == 0) {
+    const unsigned hwThreads = std::thread::hardware_concurrency();
+    numThreads = hwThreads > 1 ? hwThreads - 1 : 1;
+  }
+
+  m_threads.reserve(numThreads);
+  for (unsigned i = 0; i < numThreads; ++i)
+    m_threads.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_cond.notify_all();
+
+  for (std::thread& thread : m_threads)
+    thread.join();
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_tasks.push_back(std::move(task));
+  }
+  m_cond.notify_one();
+}
+
+void ThreadPool::parallelFor(int begin, int end, const std::function<void(int)>& fn) {
+  if (begin >= end)
+    return;
+
+  // Indices are handed out one by one, the iterations of a typical loop are much longer than the
+  // atomic increment. The helpers may only start once the loop is over when the workers are busy
+  // with long tasks (e.g. asset loading), so only the iterations are waited on: the calling thread
+  // never blocks on a helper that has not started, and the shared state outlives the late ones.
+  struct Shared {
+    std::atomic<int> next;
+    std::mutex mutex;
+    std::condition_variable done;
+    int numDone = 0;
+  };
+
+  auto shared = std::make_shared<Shared>();
+  shared->next = begin;
+  const int count = end - begin;
+  const std::function<void(int)>* fnPtr = &fn;
+
+  auto run = [shared, end, count, fnPtr]() {
+    for (int i = shared->next++; i < end; i = shared->next++) {
+      (*fnPtr)(i);
+
+      std::lock_guard<std::mutex> lock(shared->mutex);
+      if (++shared->numDone == count)
+        shared->done.notify_one();
+    }
+  };
+
+  const unsigned numHelpers = std::min(numThreads(), (unsigned)(count - 1));
+  for (unsigned i = 0; i < numHelpers; ++i)
+    submit(run);
+
+  run();
+
+  std::unique_lock<std::mutex> lock(shared->mutex);
+  shared->done.wait(lock, [&shared, count]() { return shared->numDone == count; });
+}
+
+void ThreadPool::workerLoop() {
+  for (;;) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_cond.wait(lock, [this]() { return m_stop || !m_tasks.empty(); });
+      if (m_stop && m_tasks.empty())
+        return;
+
+      task = std::move(m_tasks.front());
+      m_tasks.pop_front();
+    }
+    task();
+  }
+}
+
+} // namespace sss
@@ -0,0 +1,46 @@
+#pragma once
+#ifndef SSS_UTILS_THREADPOOL_H
+#define SSS_UTILS_THREADPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sss {
+
+// Fixed set of worker threads running queued tasks in order.
+class ThreadPool {
+public:
+  // 0 picks one thread per hardware thread, minus the calling one.
+  explicit ThreadPool(unsigned numThreads = 0);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  unsigned numThreads() const { return (unsigned)m_threads.size(); }
+
+  void submit(std::function<void()> task);
+
+  // Calls fn(i) for every i in [begin, end) from the workers and the calling thread, returns
+  // once all the calls are done. Can be called from a task, the calling thread runs the
+  // iterations the busy workers do not pick up.
+  void parallelFor(int begin, int end, const std::function<void(int)>& fn);
+
+private:
+  void workerLoop();
+
+private:
+  std::vector<std::thread> m_threads;
+  std::deque<std::function<void()>> m_tasks;
+  std::mutex m_mutex;
+  std::condition_variable m_cond;
+  bool m_stop = false;
+};
+
+} // namespace sss
+
+#endif
@@ -0,0 +1,43 @@
+#include "UploadQueue.h"
+
+#include <chrono>
+
+namespace sss {
+
+void UploadQueue::push(std::function<void()> upload) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_uploads.push_back(std::move(upload));
+}
+
+int UploadQueue::run(float budgetMs) {
+  const auto start = std::chrono::steady_clock::now();
+
+  int numRun = 0;
+  for (;;) {
+    std::function<void()> upload;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (m_uploads.empty())
+        break;
+      upload = std::move(m_uploads.front());
+      m_uploads.pop_front();
+    }
+
+    // Not under the lock, an upload may queue more work.
+    upload();
+    ++numRun;
+
+    const std::chrono::duration<float, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+    if (elapsed.count() >= budgetMs)
+      break;
+  }
+  return numRun;
+}
+
+bool UploadQueue::isEmpty() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_uploads.empty();
+}
+
+} // namespace sss
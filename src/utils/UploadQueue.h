@@ -0,0 +1,30 @@
+#pragma once
+#ifndef SSS_UTILS_UPLOADQUEUE_H
+#define SSS_UTILS_UPLOADQUEUE_H
+
+#include <deque>
+#include <functional>
+#include <mutex>
+
+namespace sss {
+
+// GL work handed over by the worker threads, run by the GL thread between frames.
+class UploadQueue {
+public:
+  // Any thread.
+  void push(std::function<void()> upload);
+
+  // GL thread only. Runs the queued uploads in order until budgetMs is spent, at least one of
+  // them runs so that the queue always drains. Returns the number of uploads run.
+  int run(float budgetMs);
+
+  bool isEmpty() const;
+
+private:
+  std::deque<std::function<void()>> m_uploads;
+  mutable std::mutex m_mutex;
+};
+
+} // namespace sss
+
+#endif